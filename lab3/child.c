@@ -5,12 +5,48 @@
 #include <ctype.h>
 #include <sys/mman.h>
 #include <fcntl.h>
-#include <semaphore.h>
+#include "ring.h"
 
 #define BUFFER_SIZE 1024
+#define OUTPUT_SIZE 65536
 #define SHM_NAME "/my_shared_memory"
-#define SEM_NAME_PARENT "/my_semaphore_parent"
-#define SEM_NAME_CHILD "/my_semaphore_child"
+
+static const char VALID[] = "Валидная строка: ";
+static const char INVALID[] = "Не валидная строка: ";
+
+// Ответы копятся и пишутся пачкой: при полном буфере и перед сном
+static char output[OUTPUT_SIZE];
+static size_t output_len = 0;
+
+static void write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        len -= written;
+    }
+}
+
+static void flush_output(int file_descriptor) {
+    write_all(STDOUT_FILENO, output, output_len);
+    write_all(file_descriptor, output, output_len);
+    output_len = 0;
+}
+
+static void check_line(const char *line, uint32_t len, int file_descriptor) {
+    int valid = len > 0 && (line[len - 1] == ';' || line[len - 1] == '.');
+    const char *prefix = valid ? VALID : INVALID;
+    size_t prefix_len = valid ? sizeof(VALID) - 1 : sizeof(INVALID) - 1;
+    if (output_len + prefix_len + len + 1 > OUTPUT_SIZE) {
+        flush_output(file_descriptor);
+    }
+    memcpy(output + output_len, prefix, prefix_len);
+    memcpy(output + output_len + prefix_len, line, len);
+    output_len += prefix_len + len;
+    output[output_len++] = '\n';
+}
 
 int main(int argc, char *argv[]) {
     int shm_fd = shm_open(SHM_NAME, O_RDWR, 0666);
@@ -20,22 +56,13 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    char *shared_memory = (char *)mmap(0, BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-    if (shared_memory == MAP_FAILED) {
+    Ring *ring = (Ring *)mmap(0, sizeof(Ring), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (ring == MAP_FAILED) {
         write(STDOUT_FILENO, "Не удалось отобразить разделяемую память\n",
               sizeof("Не удалось отобразить разделяемую память\n"));
         exit(EXIT_FAILURE);
     }
 
-    // Открываем семафоры
-    sem_t *sem_parent = sem_open(SEM_NAME_PARENT, 0);
-    sem_t *sem_child = sem_open(SEM_NAME_CHILD, 0);
-    if (sem_parent == SEM_FAILED || sem_child == SEM_FAILED) {
-        write(STDOUT_FILENO, "Не удалось открыть семафоры\n",
-              sizeof("Не удалось открыть семафоры\n"));
-        exit(EXIT_FAILURE);
-    }
-
     if (argc < 2) {
         write(STDOUT_FILENO, "Не передано имя файла\n",
               sizeof("Не передано имя файла\n"));
@@ -48,36 +75,34 @@ int main(int argc, char *argv[]) {
         exit(EXIT_FAILURE);
     }
 
-    char input[BUFFER_SIZE];
-    char output_msg[BUFFER_SIZE];
-
+    // Разбираем всё, что уже лежит в кольце, и только потом отдаём место
+    // parent; спим, лишь когда строк нет
+    RingReader reader = { ring, 0, 0, 0 };
     while (1) {
-        sem_wait(sem_child);
-
-        strncpy(input, shared_memory, BUFFER_SIZE);
-        input[BUFFER_SIZE - 1] = '\0';
+        const char *line;
+        uint32_t len;
+        while ((line = ring_next(&reader, &len)) != NULL) {
+            check_line(line, len, file_descriptor);
+            if (ring_should_release(&reader)) {
+                ring_release(&reader);
+            }
+        }
+        ring_release(&reader);
 
-        if (strlen(input) == 0) {
+        uint32_t key;
+        int state = ring_reader_check(&reader, &key);
+        if (state < 0) {
             break;
         }
-
-        int len = strlen(input);
-        if (len > 0 && (input[len - 1] == ';' || input[len - 1] == '.')) {
-            snprintf(output_msg, sizeof(output_msg), "Валидная строка: %s\n", input);
-            write(STDOUT_FILENO, output_msg, strlen(output_msg));
-            write(file_descriptor, output_msg, strlen(output_msg));
-        } else {
-            snprintf(output_msg, sizeof(output_msg), "Не валидная строка: %s\n", input);
-            write(STDOUT_FILENO, output_msg, strlen(output_msg));
-            write(file_descriptor, output_msg, strlen(output_msg));
+        if (state > 0) {
+            flush_output(file_descriptor);
+            ring_reader_sleep(&reader, key);
         }
-        sem_post(sem_parent);
     }
+    flush_output(file_descriptor);
 
-    munmap(shared_memory, BUFFER_SIZE);
+    munmap(ring, sizeof(Ring));
     close(shm_fd);
-    sem_close(sem_parent);
-    sem_close(sem_child);
     close(file_descriptor);
 
     return 0;
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <semaphore.h>
+#include "notify.h"
+
+// Задержка передачи сообщения туда и обратно между parent и child:
+// прежний путь на именованных семафорах и notify.h. Сообщение - 64 байта
+// в разделяемой памяти, как строка в старом parent.c/child.c
+
+#define MESSAGE_SIZE 64
+#define CACHE_LINE 64
+#define DEFAULT_MESSAGES 100000
+#define WARMUP 1000
+#define SEM_NAME_PING "/my_latency_ping"
+#define SEM_NAME_PONG "/my_latency_pong"
+
+typedef struct {
+    _Alignas(CACHE_LINE) char request[MESSAGE_SIZE];
+    _Alignas(CACHE_LINE) char reply[MESSAGE_SIZE];
+    _Alignas(CACHE_LINE) _Atomic uint32_t ping_count;
+    Notify ping;
+    _Alignas(CACHE_LINE) _Atomic uint32_t pong_count;
+    Notify pong;
+} Channel;
+
+typedef enum { PATH_SEMAPHORE, PATH_FUTEX } Path;
+
+static sem_t *sem_ping;
+static sem_t *sem_pong;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void wait_count(Notify *n, _Atomic uint32_t *count, uint32_t expected) {
+    while (1) {
+        uint32_t key = notify_prepare(n);
+        if (atomic_load(count) == expected) {
+            return;
+        }
+        notify_wait(n, key);
+    }
+}
+
+static void serve(Channel *ch, Path path, size_t total) {
+    for (uint32_t i = 1; i <= total; i++) {
+        if (path == PATH_SEMAPHORE) {
+            sem_wait(sem_ping);
+            memcpy(ch->reply, ch->request, MESSAGE_SIZE);
+            sem_post(sem_pong);
+        } else {
+            wait_count(&ch->ping, &ch->ping_count, i);
+            memcpy(ch->reply, ch->request, MESSAGE_SIZE);
+            atomic_store(&ch->pong_count, i);
+            notify_wake(&ch->pong);
+        }
+    }
+}
+
+static void round_trip(Channel *ch, Path path, uint32_t i) {
+    memset(ch->request, (int)(i & 0xff), MESSAGE_SIZE);
+    if (path == PATH_SEMAPHORE) {
+        sem_post(sem_ping);
+        sem_wait(sem_pong);
+    } else {
+        atomic_store(&ch->ping_count, i);
+        notify_wake(&ch->ping);
+        wait_count(&ch->pong, &ch->pong_count, i);
+    }
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Задержки в нс, отсортированные; child отвечает на все сообщения
+static int measure(Channel *ch, Path path, uint64_t *latencies, size_t messages) {
+    atomic_store(&ch->ping_count, 0);
+    atomic_store(&ch->pong_count, 0);
+    notify_init(&ch->ping);
+    notify_init(&ch->pong);
+
+    pid_t child_pid = fork();
+    if (child_pid == -1) {
+        perror("fork");
+        return -1;
+    }
+    if (child_pid == 0) {
+        serve(ch, path, WARMUP + messages);
+        _exit(EXIT_SUCCESS);
+    }
+
+    uint32_t i = 1;
+    for (size_t k = 0; k < WARMUP; k++, i++) {
+        round_trip(ch, path, i);
+    }
+    for (size_t k = 0; k < messages; k++, i++) {
+        uint64_t start = now_ns();
+        round_trip(ch, path, i);
+        latencies[k] = now_ns() - start;
+    }
+    waitpid(child_pid, NULL, 0);
+    qsort(latencies, messages, sizeof(uint64_t), compare_u64);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    size_t messages = argc > 1 ? strtoull(argv[1], NULL, 10) : DEFAULT_MESSAGES;
+    if (messages == 0) {
+        fprintf(stderr, "Usage: %s [messages]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Channel *ch = mmap(NULL, sizeof(Channel), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    uint64_t *latencies = malloc(messages * sizeof(uint64_t));
+    if (ch == MAP_FAILED || !latencies) {
+        perror("mmap/malloc");
+        return EXIT_FAILURE;
+    }
+    // Как в parent.c: именованные семафоры, их видит и child после fork
+    sem_ping = sem_open(SEM_NAME_PING, O_CREAT, 0666, 0);
+    sem_pong = sem_open(SEM_NAME_PONG, O_CREAT, 0666, 0);
+    sem_unlink(SEM_NAME_PING);
+    sem_unlink(SEM_NAME_PONG);
+    if (sem_ping == SEM_FAILED || sem_pong == SEM_FAILED) {
+        perror("sem_open");
+        return EXIT_FAILURE;
+    }
+
+    printf("Messages: %zu, CPUs: %ld\n", messages, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%-10s %10s %10s %10s %10s\n", "path", "p50 us", "p99 us", "max us", "mean us");
+    const char *names[] = { "semaphore", "futex" };
+    for (int path = PATH_SEMAPHORE; path <= PATH_FUTEX; path++) {
+        if (measure(ch, (Path)path, latencies, messages) != 0) {
+            return EXIT_FAILURE;
+        }
+        double sum = 0;
+        for (size_t k = 0; k < messages; k++) {
+            sum += latencies[k];
+        }
+        printf("%-10s %10.2f %10.2f %10.2f %10.2f\n", names[path],
+               latencies[messages / 2] / 1e3, latencies[messages * 99 / 100] / 1e3,
+               latencies[messages - 1] / 1e3, sum / messages / 1e3);
+    }
+
+    sem_close(sem_ping);
+    sem_close(sem_pong);
+    munmap(ch, sizeof(Channel));
+    free(latencies);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+#ifndef NOTIFY_H
+#define NOTIFY_H
+
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+// Ожидание события между процессами на слове в разделяемой памяти.
+// Ждущий сначала недолго крутится на слове и засыпает в futex, только
+// если событие так и не пришло. Будящий делает системный вызов, только
+// когда кто-то действительно спит. Длина кручения подстраивается: растёт,
+// если событие приходит во время кручения, и падает, если приходится
+// спать. На одном процессоре кручения нет: другая сторона всё равно не
+// работает, пока мы крутимся.
+//
+// Порядок у ждущего: key = notify_prepare(), проверка условия,
+// notify_wait(key). Будящий сначала делает условие истинным, потом
+// вызывает notify_wake. Событие после notify_prepare не теряется: seq
+// уже не равен key.
+
+// Кручение ограничено 1024 pause: около 10 тысяч тактов, единицы
+// микросекунд (у Skylake и новее pause длиннее, до ~140 тактов, и это
+// десятки микросекунд). Событие, которое приходит позже, дешевле
+// проспать в futex, чем держать ядро
+#define NOTIFY_SPIN_MIN 64
+#define NOTIFY_SPIN_MAX 1024
+
+typedef struct {
+    _Atomic uint32_t seq;       // Слово futex, +1 на каждое событие
+    _Atomic uint32_t sleepers;
+    atomic_int spin;            // Сколько раз проверить seq перед сном
+} Notify;
+
+static inline void notify_init(Notify *n) {
+    atomic_store(&n->seq, 0);
+    atomic_store(&n->sleepers, 0);
+    atomic_store(&n->spin, sysconf(_SC_NPROCESSORS_ONLN) > 1 ? NOTIFY_SPIN_MIN : 0);
+}
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static inline uint32_t notify_prepare(Notify *n) {
+    return atomic_load(&n->seq);
+}
+
+static inline void notify_wait(Notify *n, uint32_t key) {
+    int spin = atomic_load_explicit(&n->spin, memory_order_relaxed);
+    for (int i = 0; i < spin; i++) {
+        if (atomic_load_explicit(&n->seq, memory_order_acquire) != key) {
+            if (spin < NOTIFY_SPIN_MAX) {
+                atomic_store_explicit(&n->spin, spin * 2, memory_order_relaxed);
+            }
+            return;
+        }
+        cpu_relax();
+    }
+    if (spin > NOTIFY_SPIN_MIN) {
+        atomic_store_explicit(&n->spin, spin / 2, memory_order_relaxed);
+    }
+
+    // seq_cst: увеличение sleepers и чтение seq в паре с notify_wake
+    atomic_fetch_add(&n->sleepers, 1);
+    while (atomic_load(&n->seq) == key) {
+        // Ядро само сверит слово с key, поэтому пробуждение между
+        // проверкой и сном не теряется. Не FUTEX_PRIVATE: слово общее
+        // для процессов
+        syscall(SYS_futex, &n->seq, FUTEX_WAIT, key, NULL, NULL, 0);
+    }
+    atomic_fetch_sub(&n->sleepers, 1);
+}
+
+static inline void notify_wake(Notify *n) {
+    atomic_fetch_add(&n->seq, 1);
+    if (atomic_load(&n->sleepers) > 0) {
+        syscall(SYS_futex, &n->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+#endif
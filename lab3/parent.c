@@ -5,12 +5,12 @@
 #include <fcntl.h>
 #include <sys/wait.h>
 #include <sys/mman.h>
-#include <semaphore.h>
+#include "ring.h"
 
 #define BUFFER_SIZE 1024
+#define MAX_LINE (BUFFER_SIZE - 1)      // Длинные строки режутся на куски
+#define INPUT_SIZE 65536
 #define SHM_NAME "/my_shared_memory"
-#define SEM_NAME_PARENT "/my_semaphore_parent"
-#define SEM_NAME_CHILD "/my_semaphore_child"
 
 static char CLIENT_PROGRAM_NAME[] = "./child";
 
@@ -18,8 +18,22 @@ void write_string(int fd, const char *str) {
     write(fd, str, strlen(str));
 }
 
+// По байту до перевода строки: всё, что после него, остаётся строками для child
 void read_string(int fd, char *buffer, size_t size) {
-    read(fd, buffer, size);
+    size_t len = 0;
+    while (len + 1 < size && read(fd, buffer + len, 1) == 1 && buffer[len] != '\n') {
+        len++;
+    }
+    buffer[len] = '\0';
+}
+
+static void push_line(RingWriter *writer, const char *line, size_t len) {
+    while (len > MAX_LINE) {
+        ring_push(writer, line, MAX_LINE);
+        line += MAX_LINE;
+        len -= MAX_LINE;
+    }
+    ring_push(writer, line, len);
 }
 
 int main() {
@@ -34,20 +48,14 @@ int main() {
         write_string(STDOUT_FILENO, "Не удалось создать разделяемую память\n");
         exit(EXIT_FAILURE);
     }
-    ftruncate(shm_fd, BUFFER_SIZE);
+    ftruncate(shm_fd, sizeof(Ring));
 
-    char *shared_memory = (char *)mmap(0, BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-    if (shared_memory == MAP_FAILED) {
+    Ring *ring = (Ring *)mmap(0, sizeof(Ring), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if (ring == MAP_FAILED) {
         write_string(STDOUT_FILENO, "Не удалось отобразить разделяемую память\n");
         exit(EXIT_FAILURE);
     }
-
-    sem_t *sem_parent = sem_open(SEM_NAME_PARENT, O_CREAT, 0666, 0);
-    sem_t *sem_child = sem_open(SEM_NAME_CHILD, O_CREAT, 0666, 0);
-    if (sem_parent == SEM_FAILED || sem_child == SEM_FAILED) {
-        write_string(STDOUT_FILENO, "Не удалось создать семафоры\n");
-        exit(EXIT_FAILURE);
-    }
+    ring_init(ring);
 
     pid_t child_pid = fork();
     if (child_pid == -1) {
@@ -63,34 +71,43 @@ int main() {
         write(STDERR_FILENO, msg, sizeof(msg));
         exit(EXIT_FAILURE);
     } else {
-        char input[BUFFER_SIZE];
+        static char input[INPUT_SIZE];
+        size_t pending = 0;     // Начало строки без перевода строки с прошлого read
+        RingWriter writer = { ring, 0, 0 };
         const char *input_prompt = "Введите строки (CTRL+D для завершения):\n";
         write_string(STDOUT_FILENO, input_prompt);
 
+        // Строки идут в кольцо без ожидания child; ждать приходится, только
+        // когда кольцо полно
         while (1) {
-            ssize_t count = read(STDIN_FILENO, input, sizeof(input) - 1);
+            ssize_t count = read(STDIN_FILENO, input + pending, sizeof(input) - pending);
             if (count <= 0) {
                 break;
             }
-            input[count] = '\0';
-            input[strcspn(input, "\n")] = '\0';
-            strncpy(shared_memory, input, BUFFER_SIZE);
-            sem_post(sem_child);
-            sem_wait(sem_parent);
+            size_t filled = pending + count;
+            size_t start = 0;
+            char *newline;
+            while ((newline = memchr(input + start, '\n', filled - start)) != NULL) {
+                push_line(&writer, input + start, newline - (input + start));
+                start = newline - input + 1;
+            }
+            while (filled - start > MAX_LINE) {
+                ring_push(&writer, input + start, MAX_LINE);
+                start += MAX_LINE;
+            }
+            pending = filled - start;
+            memmove(input, input + start, pending);
+            ring_publish(&writer);
         }
-
-        strncpy(shared_memory, "", BUFFER_SIZE);
-        sem_post(sem_child);
+        if (pending > 0) {
+            push_line(&writer, input, pending);
+        }
+        ring_close(&writer);
 
         wait(NULL);
 
-        munmap(shared_memory, BUFFER_SIZE);
+        munmap(ring, sizeof(Ring));
         shm_unlink(SHM_NAME);
-
-        sem_close(sem_parent);
-        sem_close(sem_child);
-        sem_unlink(SEM_NAME_PARENT);
-        sem_unlink(SEM_NAME_CHILD);
     }
 
     return 0;
@@ -0,0 +1,176 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include "notify.h"
+
+// Кольцевой буфер для одного писателя и одного читателя в разделяемой
+// памяти. Записи переменной длины: 4 байта длины, затем байты строки,
+// всё выровнено на 8. head и tail - сколько байт записано и прочитано за
+// всё время; они в разных строках кэша, и каждый пишет только одна
+// сторона. Писатель публикует head, а читатель tail раз на пачку
+// записей, а не на каждую.
+//
+// Пустое и полное кольцо ждут через notify.h: сторона, которой нечего
+// делать, крутится и засыпает на слове futex в том же кольце, а другая
+// будит её системным вызовом, только если та правда спит. Пока обе
+// стороны работают, системных вызовов нет совсем.
+
+#define RING_SIZE (1 << 20)                 // Степень двойки
+#define RING_ALIGN 8
+#define RING_MAX_RECORD (RING_SIZE / 2)     // Запись с пропуском до конца влезает всегда
+#define RING_WRAP UINT32_MAX                // Остаток до конца кольца пропущен
+#define RING_RELEASE_BATCH (RING_SIZE / 4)  // Читатель отдаёт место не реже
+#define CACHE_LINE 64
+
+typedef struct {
+    _Alignas(CACHE_LINE) _Atomic uint64_t head;
+    atomic_int closed;
+    Notify data_ready;      // Писатель опубликовал записи или закрыл кольцо
+    _Alignas(CACHE_LINE) _Atomic uint64_t tail;
+    Notify room_ready;      // Читатель освободил место
+    _Alignas(CACHE_LINE) char data[RING_SIZE];
+} Ring;
+
+typedef struct {
+    Ring *ring;
+    uint64_t head;          // Записано, но, может быть, ещё не опубликовано
+    uint64_t tail;          // Последний прочитанный tail читателя
+} RingWriter;
+
+typedef struct {
+    Ring *ring;
+    uint64_t tail;          // Прочитано, но место ещё не отдано писателю
+    uint64_t head;          // Последний прочитанный head писателя
+    uint64_t released;      // Последний опубликованный tail
+} RingReader;
+
+static inline void ring_init(Ring *ring) {
+    atomic_store(&ring->head, 0);
+    atomic_store(&ring->tail, 0);
+    atomic_store(&ring->closed, 0);
+    notify_init(&ring->data_ready);
+    notify_init(&ring->room_ready);
+}
+
+static inline uint64_t ring_record_size(uint32_t len) {
+    return (sizeof(uint32_t) + len + RING_ALIGN - 1) & ~(uint64_t)(RING_ALIGN - 1);
+}
+
+// Место под запись с пропуском хвоста, если подряд она не помещается
+static inline uint64_t ring_need(uint64_t head, uint32_t len) {
+    uint64_t size = ring_record_size(len);
+    uint64_t to_end = RING_SIZE - (head & (RING_SIZE - 1));
+    return size <= to_end ? size : to_end + size;
+}
+
+static inline int ring_has_room(const RingWriter *w, uint32_t len) {
+    return w->head + ring_need(w->head, len) - w->tail <= RING_SIZE;
+}
+
+// 0 - места нет; tail читателя перечитывается только в этом случае.
+// len не больше RING_MAX_RECORD
+static inline int ring_try_push(RingWriter *w, const void *record, uint32_t len) {
+    if (!ring_has_room(w, len)) {
+        w->tail = atomic_load_explicit(&w->ring->tail, memory_order_acquire);
+        if (!ring_has_room(w, len)) {
+            return 0;
+        }
+    }
+    uint64_t at = w->head & (RING_SIZE - 1);
+    if (ring_need(w->head, len) != ring_record_size(len)) {
+        uint32_t wrap = RING_WRAP;
+        memcpy(w->ring->data + at, &wrap, sizeof(wrap));
+        w->head += RING_SIZE - at;
+        at = 0;
+    }
+    memcpy(w->ring->data + at, &len, sizeof(len));
+    memcpy(w->ring->data + at + sizeof(len), record, len);
+    w->head += ring_record_size(len);
+    return 1;
+}
+
+// Делает записанное видимым читателю. Будит его, если он спит
+static inline void ring_publish(RingWriter *w) {
+    atomic_store(&w->ring->head, w->head);
+    notify_wake(&w->ring->data_ready);
+}
+
+// Больше записей не будет; closed ставится после head, чтобы читатель,
+// увидевший его, видел и последние записи
+static inline void ring_close(RingWriter *w) {
+    atomic_store(&w->ring->head, w->head);
+    atomic_store(&w->ring->closed, 1);
+    notify_wake(&w->ring->data_ready);
+}
+
+// ring_try_push, который ждёт места: записанное публикуется, и писатель
+// спит, пока читатель не освободит достаточно
+static inline void ring_push(RingWriter *w, const void *record, uint32_t len) {
+    while (!ring_try_push(w, record, len)) {
+        ring_publish(w);
+        uint32_t key = notify_prepare(&w->ring->room_ready);
+        w->tail = atomic_load(&w->ring->tail);
+        if (!ring_has_room(w, len)) {
+            notify_wait(&w->ring->room_ready, key);
+        }
+    }
+}
+
+// Следующая запись или NULL, если опубликованных больше нет. Запись
+// читается прямо из кольца и жива до ring_release
+static inline const char *ring_next(RingReader *r, uint32_t *len) {
+    if (r->tail == r->head) {
+        r->head = atomic_load_explicit(&r->ring->head, memory_order_acquire);
+        if (r->tail == r->head) {
+            return NULL;
+        }
+    }
+    uint64_t at = r->tail & (RING_SIZE - 1);
+    uint32_t n;
+    memcpy(&n, r->ring->data + at, sizeof(n));
+    if (n == RING_WRAP) {
+        // За пропуском всегда есть запись: писатель публикует их вместе
+        r->tail += RING_SIZE - at;
+        at = 0;
+        memcpy(&n, r->ring->data, sizeof(n));
+    }
+    r->tail += ring_record_size(n);
+    *len = n;
+    return r->ring->data + at + sizeof(n);
+}
+
+// Отдаёт писателю место прочитанных записей и будит его, если он спит
+static inline void ring_release(RingReader *r) {
+    r->released = r->tail;
+    atomic_store(&r->ring->tail, r->tail);
+    notify_wake(&r->ring->room_ready);
+}
+
+// Пока записи идут потоком, ring_next может не вернуть NULL долго, и
+// место отдаётся по мере чтения, чтобы писатель не простаивал
+static inline int ring_should_release(const RingReader *r) {
+    return r->tail - r->released >= RING_RELEASE_BATCH;
+}
+
+// Когда ring_next вернул NULL: 0 - записи появились, -1 - кольцо закрыто
+// и прочитано, 1 - записей нет, и можно ждать их ring_reader_sleep(key).
+// Между ними читатель успевает сделать своё (сбросить вывод): записи,
+// пришедшие за это время, не потеряются
+static inline int ring_reader_check(RingReader *r, uint32_t *key) {
+    *key = notify_prepare(&r->ring->data_ready);
+    int closed = atomic_load(&r->ring->closed);
+    r->head = atomic_load(&r->ring->head);
+    if (r->head != r->tail) {
+        return 0;
+    }
+    return closed ? -1 : 1;
+}
+
+static inline void ring_reader_sleep(RingReader *r, uint32_t key) {
+    notify_wait(&r->ring->data_ready, key);
+}
+
+#endif
@@ -18,4 +18,55 @@ void* allocator_alloc(Allocator* allocator, size_t size);
 void allocator_free(Allocator* allocator, void* ptr);
 AllocatorStats allocator_get_stats(Allocator* allocator);
 
+// Пакетные операции (необязательные): n блоков одного размера за один поиск,
+// освобождение со слиянием соседних блоков пакета. Возвращает число
+// выделенных блоков, они записываются в out[0..результат). free_batch
+// переставляет ptrs (сортирует по адресу), содержимое массива сохраняется
+size_t allocator_alloc_batch(Allocator* allocator, size_t size, void** out, size_t n);
+void allocator_free_batch(Allocator* allocator, void** ptrs, size_t n);
+
+// Изменение размера (необязательное): на месте, если позволяет раскладка,
+// иначе перенос с копированием. ptr == NULL - как alloc, size == 0 - как free
+void* allocator_realloc(Allocator* allocator, void* ptr, size_t size);
+// Выделение с выравниванием на степень двойки (строка кэша, страница)
+void* allocator_aligned_alloc(Allocator* allocator, size_t alignment, size_t size);
+
+// Интроспекция (необязательная). Все размеры - полезные байты, то есть
+// сколько можно запросить из блока, без заголовков
+
+#define ALLOCATOR_MAX_CLASSES 128
+
+// Класс размеров: порядок buddy, класс slab/segregated или диапазон
+// [2^k, 2^(k+1)) у единого списка свободных блоков
+typedef struct {
+    size_t block_size;     // Нижняя граница размеров класса
+    size_t free_blocks;
+    size_t largest_free;
+} AllocatorClassInfo;
+
+typedef struct {
+    size_t live_requested;          // Запрошено живыми блоками
+    size_t live_allocated;          // Занято ими вместе с округлением и метаданными
+    size_t live_blocks;
+    size_t peak_requested;          // Максимумы за время жизни аллокатора
+    size_t peak_allocated;
+    size_t free_bytes;
+    size_t free_blocks;
+    size_t largest_free;
+    double external_fragmentation;  // 1 - largest_free / free_bytes
+    size_t num_classes;
+    AllocatorClassInfo classes[ALLOCATOR_MAX_CLASSES];
+} AllocatorInfo;
+
+// Сводка без обхода кучи: счётчики ведутся при alloc/free, поэтому опрос
+// стоит порядка числа классов (единый список обходится, как при одном
+// поиске блока, лишь после ухода наибольшего блока класса) и годится
+// для периодического вызова
+void allocator_get_info(Allocator* allocator, AllocatorInfo* info);
+
+// Обход всех блоков по возрастанию адресов. Ненулевой результат
+// callback'а прекращает обход. Во время обхода кучу менять нельзя
+typedef int (*AllocatorWalkFunc)(void* ptr, size_t size, int used, void* arg);
+void allocator_walk(Allocator* allocator, AllocatorWalkFunc callback, void* arg);
+
 #endif
\ No newline at end of file
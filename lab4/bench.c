@@ -0,0 +1,541 @@
+#include "bench.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#define RING_SIZE 4096
+#define REALLOC_BUFFERS 64
+
+typedef struct {
+    uint64_t state;
+} Rng;
+
+typedef struct {
+    uint32_t* values;      // Задержки операций в наносекундах
+    size_t count;
+    size_t capacity;
+} Samples;
+
+typedef struct {
+    const BenchAllocator* lib;
+    const BenchConfig* config;
+    Allocator* allocator;
+    pthread_mutex_t lock;  // Для аллокаторов без собственной синхронизации
+    atomic_size_t failed;
+    double fragmentation;  // < 0 - не измерялась
+} BenchContext;
+
+typedef struct {
+    const char* workload;
+    int threads;
+    size_t ops;
+    double seconds;
+    uint32_t p50, p99, p999;
+    long peak_rss_kb;
+    double fragmentation;
+    size_t failed;
+} BenchResult;
+
+static int json_first = 1;
+
+void bench_default_config(BenchConfig* config) {
+    config->arena_size = 1 << 26;
+    config->ops = 1000000;
+    config->live = 10000;
+    config->dist = DIST_UNIFORM;
+    config->min_size = 16;
+    config->max_size = 512;
+    config->threads = 4;
+    config->seed = 42;
+    config->format = FORMAT_TEXT;
+}
+
+int bench_parse_distribution(const char* name) {
+    if (strcmp(name, "uniform") == 0) return DIST_UNIFORM;
+    if (strcmp(name, "loguniform") == 0) return DIST_LOG_UNIFORM;
+    if (strcmp(name, "fixed") == 0) return DIST_FIXED;
+    return -1;
+}
+
+int bench_parse_format(const char* name) {
+    if (strcmp(name, "text") == 0) return FORMAT_TEXT;
+    if (strcmp(name, "csv") == 0) return FORMAT_CSV;
+    if (strcmp(name, "json") == 0) return FORMAT_JSON;
+    return -1;
+}
+
+static inline uint64_t rng_next(Rng* rng) {
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+    return rng->state * 0x2545F4914F6CDD1Dull;
+}
+
+static Rng rng_seed(unsigned seed, unsigned stream) {
+    Rng rng = {((uint64_t)seed << 32 | stream) * 0x9E3779B97F4A7C15ull + 1};
+    rng_next(&rng);
+    return rng;
+}
+
+static size_t random_size(const BenchConfig* config, Rng* rng) {
+    size_t min = config->min_size, max = config->max_size;
+    switch (config->dist) {
+    case DIST_FIXED:
+        return min;
+    case DIST_LOG_UNIFORM: {
+        // Сначала октава, затем размер внутри неё
+        size_t octaves = 1;
+        while ((min << octaves) <= max) octaves++;
+        size_t low = min << (rng_next(rng) % octaves);
+        size_t high = low * 2 - 1 < max ? low * 2 - 1 : max;
+        return low + rng_next(rng) % (high - low + 1);
+    }
+    default:
+        return min + rng_next(rng) % (max - min + 1);
+    }
+}
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void samples_init(Samples* samples, size_t capacity) {
+    samples->values = malloc(capacity * sizeof(uint32_t));
+    // Память под замеры трогаем заранее, чтобы она не попала в пиковый RSS
+    if (samples->values) memset(samples->values, 0, capacity * sizeof(uint32_t));
+    samples->count = 0;
+    samples->capacity = samples->values ? capacity : 0;
+}
+
+static inline void samples_add(Samples* samples, uint64_t ns) {
+    if (samples->count < samples->capacity) {
+        samples->values[samples->count++] = ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns;
+    }
+}
+
+// Пишем в края блока, чтобы его страницы попали в RSS, как в реальной программе
+static inline void touch(void* ptr, size_t size) {
+    ((volatile char*)ptr)[0] = 1;
+    ((volatile char*)ptr)[size - 1] = 1;
+}
+
+static void* timed_alloc(BenchContext* ctx, size_t size, Samples* samples) {
+    uint64_t start = now_ns();
+    if (!ctx->lib->thread_safe) pthread_mutex_lock(&ctx->lock);
+    void* ptr = ctx->lib->alloc(ctx->allocator, size);
+    if (!ctx->lib->thread_safe) pthread_mutex_unlock(&ctx->lock);
+    samples_add(samples, now_ns() - start);
+    if (ptr) touch(ptr, size);
+    else atomic_fetch_add_explicit(&ctx->failed, 1, memory_order_relaxed);
+    return ptr;
+}
+
+static void timed_free(BenchContext* ctx, void* ptr, Samples* samples) {
+    if (!ptr) return;
+    uint64_t start = now_ns();
+    if (!ctx->lib->thread_safe) pthread_mutex_lock(&ctx->lock);
+    ctx->lib->free(ctx->allocator, ptr);
+    if (!ctx->lib->thread_safe) pthread_mutex_unlock(&ctx->lock);
+    samples_add(samples, now_ns() - start);
+}
+
+static void* timed_realloc(BenchContext* ctx, void* ptr, size_t size, Samples* samples) {
+    uint64_t start = now_ns();
+    if (!ctx->lib->thread_safe) pthread_mutex_lock(&ctx->lock);
+    void* result = ctx->lib->realloc(ctx->allocator, ptr, size);
+    if (!ctx->lib->thread_safe) pthread_mutex_unlock(&ctx->lock);
+    samples_add(samples, now_ns() - start);
+    if (result) touch(result, size);
+    else atomic_fetch_add_explicit(&ctx->failed, 1, memory_order_relaxed);
+    return result;
+}
+
+// Внутренняя фрагментация по статистике аллокатора в момент пика
+static void sample_fragmentation(BenchContext* ctx) {
+    if (!ctx->lib->thread_safe) pthread_mutex_lock(&ctx->lock);
+    AllocatorStats stats = ctx->lib->stats(ctx->allocator);
+    if (!ctx->lib->thread_safe) pthread_mutex_unlock(&ctx->lock);
+    if (stats.allocated > 0 && stats.requested <= stats.allocated) {
+        double fragmentation = 1.0 - (double)stats.requested / stats.allocated;
+        if (fragmentation > ctx->fragmentation) ctx->fragmentation = fragmentation;
+    }
+}
+
+static long read_status_kb(const char* field) {
+    FILE* status = fopen("/proc/self/status", "r");
+    if (!status) return -1;
+    char line[256];
+    long value = -1;
+    size_t len = strlen(field);
+    while (fgets(line, sizeof(line), status)) {
+        if (strncmp(line, field, len) == 0) {
+            value = strtol(line + len, NULL, 10);
+            break;
+        }
+    }
+    fclose(status);
+    return value;
+}
+
+// Сброс VmHWM до текущего RSS (Linux 4.0+)
+static void reset_peak_rss(void) {
+    FILE* refs = fopen("/proc/self/clear_refs", "w");
+    if (!refs) return;
+    fputs("5", refs);
+    fclose(refs);
+}
+
+// ---- Случайные размеры, разный порядок освобождения ----
+
+typedef enum { ORDER_LIFO, ORDER_FIFO, ORDER_RANDOM } FreeOrder;
+
+static size_t run_free_order(BenchContext* ctx, FreeOrder order, Samples* samples) {
+    const BenchConfig* config = ctx->config;
+    void** blocks = malloc(config->live * sizeof(void*));
+    Rng rng = rng_seed(config->seed, order);
+    size_t done = 0;
+    if (!blocks) return 0;
+
+    while (done < config->ops) {
+        size_t n = 0;
+        for (; n < config->live && done < config->ops; n++, done++) {
+            blocks[n] = timed_alloc(ctx, random_size(config, &rng), samples);
+        }
+        sample_fragmentation(ctx);
+
+        if (order == ORDER_RANDOM) {
+            for (size_t i = n; i > 1; i--) {
+                size_t j = rng_next(&rng) % i;
+                void* tmp = blocks[i - 1];
+                blocks[i - 1] = blocks[j];
+                blocks[j] = tmp;
+            }
+        }
+        for (size_t i = 0; i < n; i++, done++) {
+            timed_free(ctx, blocks[order == ORDER_LIFO ? n - 1 - i : i], samples);
+        }
+    }
+
+    free(blocks);
+    return done;
+}
+
+// ---- Churn в стиле larson: потоки заменяют случайные блоки своего набора ----
+
+typedef struct {
+    BenchContext* ctx;
+    Samples samples;
+    void** slots;
+    size_t num_slots;
+    size_t ops;
+    unsigned stream;
+} ChurnArgs;
+
+static void* churn_worker(void* arg) {
+    ChurnArgs* args = arg;
+    const BenchConfig* config = args->ctx->config;
+    Rng rng = rng_seed(config->seed, args->stream);
+
+    for (size_t i = 0; i < args->num_slots; i++) {
+        args->slots[i] = timed_alloc(args->ctx, random_size(config, &rng), &args->samples);
+    }
+    for (size_t i = 0; i < args->ops; i++) {
+        size_t idx = rng_next(&rng) % args->num_slots;
+        timed_free(args->ctx, args->slots[idx], &args->samples);
+        args->slots[idx] = timed_alloc(args->ctx, random_size(config, &rng), &args->samples);
+    }
+    return NULL;
+}
+
+// ---- Производитель-потребитель в стиле xmalloc: освобождает другой поток ----
+
+typedef struct {
+    _Alignas(64) atomic_size_t head;
+    _Alignas(64) atomic_size_t tail;
+    void* items[RING_SIZE];
+} Ring;
+
+typedef struct {
+    BenchContext* ctx;
+    Samples samples;
+    Ring* ring;
+    size_t count;
+    unsigned stream;
+} PipeArgs;
+
+static void* producer_worker(void* arg) {
+    PipeArgs* args = arg;
+    Rng rng = rng_seed(args->ctx->config->seed, args->stream);
+    for (size_t i = 0; i < args->count; i++) {
+        void* ptr = timed_alloc(args->ctx, random_size(args->ctx->config, &rng), &args->samples);
+        size_t tail = atomic_load_explicit(&args->ring->tail, memory_order_relaxed);
+        while (tail - atomic_load_explicit(&args->ring->head, memory_order_acquire) == RING_SIZE) {
+            sched_yield();
+        }
+        args->ring->items[tail % RING_SIZE] = ptr;
+        atomic_store_explicit(&args->ring->tail, tail + 1, memory_order_release);
+    }
+    return NULL;
+}
+
+static void* consumer_worker(void* arg) {
+    PipeArgs* args = arg;
+    for (size_t i = 0; i < args->count; i++) {
+        size_t head = atomic_load_explicit(&args->ring->head, memory_order_relaxed);
+        while (atomic_load_explicit(&args->ring->tail, memory_order_acquire) == head) {
+            sched_yield();
+        }
+        void* ptr = args->ring->items[head % RING_SIZE];
+        atomic_store_explicit(&args->ring->head, head + 1, memory_order_release);
+        timed_free(args->ctx, ptr, &args->samples);
+    }
+    return NULL;
+}
+
+static void merge_samples(Samples* into, Samples* from) {
+    size_t room = into->capacity - into->count;
+    size_t n = from->count < room ? from->count : room;
+    memcpy(into->values + into->count, from->values, n * sizeof(uint32_t));
+    into->count += n;
+    free(from->values);
+}
+
+static size_t run_churn(BenchContext* ctx, Samples* samples) {
+    const BenchConfig* config = ctx->config;
+    int threads = config->threads;
+    pthread_t tids[threads];
+    ChurnArgs args[threads];
+    size_t per_thread = config->ops / 2 / threads;
+    size_t slots = config->live / threads ? config->live / threads : 1;
+
+    for (int i = 0; i < threads; i++) {
+        args[i] = (ChurnArgs){ctx, {0}, calloc(slots, sizeof(void*)), slots, per_thread, 100 + i};
+        samples_init(&args[i].samples, slots + 2 * per_thread);
+    }
+    for (int i = 0; i < threads; i++) pthread_create(&tids[i], NULL, churn_worker, &args[i]);
+    for (int i = 0; i < threads; i++) pthread_join(tids[i], NULL);
+
+    sample_fragmentation(ctx);
+    size_t done = 0;
+    for (int i = 0; i < threads; i++) {
+        for (size_t j = 0; j < slots; j++) {
+            if (args[i].slots[j]) ctx->lib->free(ctx->allocator, args[i].slots[j]);
+        }
+        done += slots + 2 * per_thread;
+        free(args[i].slots);
+        merge_samples(samples, &args[i].samples);
+    }
+    return done;
+}
+
+static size_t run_producer_consumer(BenchContext* ctx, Samples* samples) {
+    const BenchConfig* config = ctx->config;
+    int pairs = config->threads / 2 ? config->threads / 2 : 1;
+    pthread_t tids[2 * pairs];
+    PipeArgs args[2 * pairs];
+    Ring* rings = aligned_alloc(64, pairs * sizeof(Ring));
+    size_t per_pair = config->ops / 2 / pairs;
+
+    for (int i = 0; i < pairs; i++) {
+        atomic_init(&rings[i].head, 0);
+        atomic_init(&rings[i].tail, 0);
+        args[2 * i] = (PipeArgs){ctx, {0}, &rings[i], per_pair, 200 + i};
+        args[2 * i + 1] = (PipeArgs){ctx, {0}, &rings[i], per_pair, 0};
+        samples_init(&args[2 * i].samples, per_pair);
+        samples_init(&args[2 * i + 1].samples, per_pair);
+    }
+    for (int i = 0; i < pairs; i++) {
+        pthread_create(&tids[2 * i], NULL, producer_worker, &args[2 * i]);
+        pthread_create(&tids[2 * i + 1], NULL, consumer_worker, &args[2 * i + 1]);
+    }
+    for (int i = 0; i < 2 * pairs; i++) {
+        pthread_join(tids[i], NULL);
+        merge_samples(samples, &args[i].samples);
+    }
+    free(rings);
+    return 2 * per_pair * pairs;
+}
+
+// ---- Рост буферов через realloc ----
+
+static size_t run_realloc(BenchContext* ctx, Samples* samples) {
+    const BenchConfig* config = ctx->config;
+    void* buffers[REALLOC_BUFFERS] = {0};
+    size_t sizes[REALLOC_BUFFERS];
+    size_t limit = config->max_size * 64;
+    size_t done = 0;
+
+    for (int i = 0; i < REALLOC_BUFFERS; i++) sizes[i] = 0;
+    while (done < config->ops) {
+        for (int i = 0; i < REALLOC_BUFFERS && done < config->ops; i++, done++) {
+            // Буфер растёт на четверть до предела, затем начинает заново
+            size_t next = sizes[i] ? sizes[i] + sizes[i] / 4 + 1 : config->min_size;
+            if (next > limit) {
+                timed_free(ctx, buffers[i], samples);
+                buffers[i] = NULL;
+                sizes[i] = 0;
+                continue;
+            }
+            void* grown = timed_realloc(ctx, buffers[i], next, samples);
+            if (grown) {
+                buffers[i] = grown;
+                sizes[i] = next;
+            }
+        }
+        if (done % (REALLOC_BUFFERS * 16) == 0) sample_fragmentation(ctx);
+    }
+
+    for (int i = 0; i < REALLOC_BUFFERS; i++) {
+        if (buffers[i]) ctx->lib->free(ctx->allocator, buffers[i]);
+    }
+    return done;
+}
+
+// ---- Вывод ----
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const Samples* samples, double p) {
+    if (!samples->count) return 0;
+    size_t idx = (size_t)(p * (samples->count - 1));
+    return samples->values[idx];
+}
+
+static void print_json_string(const char* str) {
+    putchar('"');
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\') putchar('\\');
+        putchar(*str);
+    }
+    putchar('"');
+}
+
+static void print_result(const BenchAllocator* lib, const BenchConfig* config, const BenchResult* r) {
+    double ops_per_sec = r->seconds > 0 ? r->ops / r->seconds : 0;
+    switch (config->format) {
+    case FORMAT_CSV:
+        printf("%s,%s,%d,%zu,%.6f,%.0f,%u,%u,%u,%ld,", lib->name, r->workload, r->threads,
+               r->ops, r->seconds, ops_per_sec, r->p50, r->p99, r->p999, r->peak_rss_kb);
+        if (r->fragmentation >= 0) printf("%.4f", r->fragmentation);
+        printf(",%zu\n", r->failed);
+        break;
+    case FORMAT_JSON:
+        printf("%s\n  {\"allocator\": ", json_first ? "" : ",");
+        json_first = 0;
+        print_json_string(lib->name);
+        printf(", \"workload\": \"%s\", \"threads\": %d, \"ops\": %zu, \"seconds\": %.6f, "
+               "\"ops_per_sec\": %.0f, \"p50_ns\": %u, \"p99_ns\": %u, \"p999_ns\": %u, "
+               "\"peak_rss_kb\": %ld, \"fragmentation\": ",
+               r->workload, r->threads, r->ops, r->seconds, ops_per_sec,
+               r->p50, r->p99, r->p999, r->peak_rss_kb);
+        if (r->fragmentation >= 0) printf("%.4f", r->fragmentation); else printf("null");
+        printf(", \"failed\": %zu}", r->failed);
+        break;
+    default:
+        printf("%-18s %7d %12.0f %8u %8u %8u %10ld ", r->workload, r->threads, ops_per_sec,
+               r->p50, r->p99, r->p999, r->peak_rss_kb);
+        if (r->fragmentation >= 0) printf("%6.1f%%", r->fragmentation * 100); else printf("%7s", "-");
+        if (r->failed) printf("  (%zu failed)", r->failed);
+        printf("\n");
+        break;
+    }
+}
+
+void bench_begin(const BenchConfig* config) {
+    if (config->format == FORMAT_CSV) {
+        printf("allocator,workload,threads,ops,seconds,ops_per_sec,p50_ns,p99_ns,p999_ns,"
+               "peak_rss_kb,fragmentation,failed\n");
+    } else if (config->format == FORMAT_JSON) {
+        printf("[");
+        json_first = 1;
+    }
+}
+
+void bench_end(const BenchConfig* config) {
+    if (config->format == FORMAT_JSON) printf("\n]\n");
+}
+
+typedef enum { WL_LIFO, WL_FIFO, WL_RANDOM, WL_CHURN, WL_PRODUCER_CONSUMER, WL_REALLOC, WL_COUNT } Workload;
+
+static const char* workload_names[WL_COUNT] = {
+    "lifo", "fifo", "random", "churn", "producer-consumer", "realloc"
+};
+
+void bench_run(const BenchAllocator* lib, const BenchConfig* config) {
+    if (config->format == FORMAT_TEXT) {
+        printf("%-18s %7s %12s %8s %8s %8s %10s %7s\n", "workload", "threads", "ops/sec",
+               "p50 ns", "p99 ns", "p999 ns", "rss KB", "frag");
+    }
+
+    for (int w = 0; w < WL_COUNT; w++) {
+        if (w == WL_REALLOC && !lib->realloc) continue;
+
+        BenchContext ctx = {lib, config, NULL, PTHREAD_MUTEX_INITIALIZER, 0, -1.0};
+        Samples samples;
+        samples_init(&samples, config->ops + config->live + 2 * config->threads);
+
+        void* memory = mmap(NULL, config->arena_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (memory == MAP_FAILED) {
+            fprintf(stderr, "mmap failed for arena of %zu bytes\n", config->arena_size);
+            free(samples.values);
+            return;
+        }
+        ctx.allocator = lib->create(memory, config->arena_size);
+        if (!ctx.allocator) {
+            fprintf(stderr, "%s: create failed for arena of %zu bytes\n", lib->name,
+                    config->arena_size);
+            munmap(memory, config->arena_size);
+            free(samples.values);
+            return;
+        }
+
+        reset_peak_rss();
+        long rss_before = read_status_kb("VmRSS:");
+        uint64_t start = now_ns();
+
+        BenchResult result = {workload_names[w], 1, 0, 0, 0, 0, 0, 0, -1.0, 0};
+        switch (w) {
+        case WL_LIFO: result.ops = run_free_order(&ctx, ORDER_LIFO, &samples); break;
+        case WL_FIFO: result.ops = run_free_order(&ctx, ORDER_FIFO, &samples); break;
+        case WL_RANDOM: result.ops = run_free_order(&ctx, ORDER_RANDOM, &samples); break;
+        case WL_CHURN:
+            result.threads = config->threads;
+            result.ops = run_churn(&ctx, &samples);
+            break;
+        case WL_PRODUCER_CONSUMER:
+            result.threads = config->threads / 2 ? config->threads / 2 * 2 : 2;
+            result.ops = run_producer_consumer(&ctx, &samples);
+            break;
+        case WL_REALLOC: result.ops = run_realloc(&ctx, &samples); break;
+        }
+
+        result.seconds = (now_ns() - start) / 1e9;
+        long peak = read_status_kb("VmHWM:");
+        result.peak_rss_kb = peak >= 0 && rss_before >= 0 ? peak - rss_before : -1;
+        result.fragmentation = ctx.fragmentation;
+        result.failed = atomic_load(&ctx.failed);
+
+        qsort(samples.values, samples.count, sizeof(uint32_t), compare_u32);
+        result.p50 = percentile(&samples, 0.50);
+        result.p99 = percentile(&samples, 0.99);
+        result.p999 = percentile(&samples, 0.999);
+        print_result(lib, config, &result);
+
+        lib->destroy(ctx.allocator);
+        munmap(memory, config->arena_size);
+        pthread_mutex_destroy(&ctx.lock);
+        free(samples.values);
+    }
+}
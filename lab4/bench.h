@@ -0,0 +1,58 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include "allocator.h"
+
+// Набор нагрузок для сравнения аллокаторов: случайные размеры с разным
+// порядком освобождения, churn в нескольких потоках, производитель-потребитель
+// и рост через realloc. Для каждой нагрузки - перцентили задержки операции,
+// пропускная способность, пиковый RSS и фрагментация.
+
+typedef struct {
+    const char* name;
+    Allocator* (*create)(void*, size_t);
+    void (*destroy)(Allocator*);
+    void* (*alloc)(Allocator*, size_t);
+    void (*free)(Allocator*, void*);
+    AllocatorStats (*stats)(Allocator*);
+    void* (*realloc)(Allocator*, void*, size_t);   // NULL - нагрузка пропускается
+    int thread_safe;                               // 0 - вызовы под мьютексом
+} BenchAllocator;
+
+typedef enum {
+    DIST_UNIFORM,      // Равномерно в [min_size, max_size]
+    DIST_LOG_UNIFORM,  // Равномерно по логарифму: много мелких, мало крупных
+    DIST_FIXED         // Всегда min_size
+} SizeDistribution;
+
+typedef enum {
+    FORMAT_TEXT,
+    FORMAT_CSV,
+    FORMAT_JSON
+} OutputFormat;
+
+typedef struct {
+    size_t arena_size;
+    size_t ops;            // Операций на нагрузку
+    size_t live;           // Одновременно живых блоков
+    SizeDistribution dist;
+    size_t min_size;
+    size_t max_size;
+    int threads;
+    unsigned seed;
+    OutputFormat format;
+} BenchConfig;
+
+void bench_default_config(BenchConfig* config);
+// Разбор "uniform", "loguniform", "fixed"; -1 при ошибке
+int bench_parse_distribution(const char* name);
+// Разбор "text", "csv", "json"; -1 при ошибке
+int bench_parse_format(const char* name);
+
+// bench_begin/bench_end печатают заголовок CSV и скобки массива JSON
+void bench_begin(const BenchConfig* config);
+void bench_run(const BenchAllocator* allocator, const BenchConfig* config);
+void bench_end(const BenchConfig* config);
+
+#endif
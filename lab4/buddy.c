@@ -5,23 +5,44 @@
 #include <string.h>
 #include <stdio.h>
 
-typedef struct BuddyBlock {
-    size_t size;
-    bool free;
-    struct BuddyBlock* next;
-} BuddyBlock;
+// Состояние блоков хранится в битовых картах вне управляемой памяти:
+// для каждого порядка k (блок 2^k байт) бит "свободен" и бит "разделён".
+// Занятый блок не имеет заголовка, его порядок восстанавливается по битам
+// разделения предков. Свободные блоки связаны в двусвязные списки прямо
+// внутри себя, поэтому удаление приятеля - O(1).
+
+#define MAX_ORDERS 64
+#define SMALL_SLACK_ORDER 16   // Запас блоков до 2^16 байт помещается в uint16_t
+
+typedef struct FreeNode {
+    struct FreeNode* next;
+    struct FreeNode* prev;
+} FreeNode;
 
 typedef struct {
     void* memory;
     size_t total_size;
     size_t min_order;
-    BuddyBlock* free_lists[32];
+    size_t max_order;
+    FreeNode* free_lists[MAX_ORDERS];
+    uint64_t nonempty;                 // Бит k установлен, если free_lists[k] не пуст
+    size_t free_count[MAX_ORDERS];
+    uint64_t* free_map[MAX_ORDERS];
+    uint64_t* split_map[MAX_ORDERS];
+    // Размер блока минус запрошенный: у блоков до 2^SMALL_SLACK_ORDER -
+    // по минимальному блоку, у крупных - по блоку своего порядка
+    uint16_t* slack;
+    size_t* large_slack[MAX_ORDERS];
+    void* metadata;
     size_t total_requested;
     size_t total_allocated;
+    size_t live_blocks;
+    size_t peak_requested;
+    size_t peak_allocated;
 } BuddyAllocator;
 
 static size_t next_pow2(size_t size) {
-    if (size == 0) return 1;
+    if (size <= 1) return 1;
     return 1ull << (64 - __builtin_clzl(size - 1));
 }
 
@@ -29,111 +50,408 @@ static size_t get_level(size_t size) {
     return 64 - __builtin_clzl(size) - 1;
 }
 
+static inline bool test_bit(const uint64_t* map, size_t index) {
+    return (map[index / 64] >> (index % 64)) & 1;
+}
+
+static inline void set_bit(uint64_t* map, size_t index) {
+    map[index / 64] |= 1ull << (index % 64);
+}
+
+static inline void clear_bit(uint64_t* map, size_t index) {
+    map[index / 64] &= ~(1ull << (index % 64));
+}
+
+static inline FreeNode* block_at(BuddyAllocator* alloc, size_t order, size_t index) {
+    return (FreeNode*)((char*)alloc->memory + (index << order));
+}
+
+static void push_free(BuddyAllocator* alloc, size_t order, size_t index) {
+    FreeNode* node = block_at(alloc, order, index);
+    node->prev = NULL;
+    node->next = alloc->free_lists[order];
+    if (node->next) node->next->prev = node;
+    alloc->free_lists[order] = node;
+    alloc->nonempty |= 1ull << order;
+    alloc->free_count[order]++;
+    set_bit(alloc->free_map[order], index);
+}
+
+static void remove_free(BuddyAllocator* alloc, size_t order, size_t index) {
+    FreeNode* node = block_at(alloc, order, index);
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        alloc->free_lists[order] = node->next;
+    }
+    if (node->next) node->next->prev = node->prev;
+    if (!alloc->free_lists[order]) alloc->nonempty &= ~(1ull << order);
+    alloc->free_count[order]--;
+    clear_bit(alloc->free_map[order], index);
+}
+
+static size_t pop_free(BuddyAllocator* alloc, size_t order) {
+    size_t index = ((char*)alloc->free_lists[order] - (char*)alloc->memory) >> order;
+    remove_free(alloc, order, index);
+    return index;
+}
+
 Allocator* allocator_create(void* memory, size_t size) {
+    const size_t min_order = 5; // Минимальный блок 32 байта
+    uintptr_t start = ((uintptr_t)memory + (1u << min_order) - 1) & ~(uintptr_t)((1u << min_order) - 1);
+    if ((uintptr_t)memory + size <= start + (1u << min_order)) {
+        fprintf(stderr, "Memory size too small\n");
+        return NULL;
+    }
+
     BuddyAllocator* alloc = malloc(sizeof(BuddyAllocator));
+    if (!alloc) return NULL;
     memset(alloc, 0, sizeof(BuddyAllocator));
-    
-    size_t actual_size = next_pow2(size);
-    alloc->memory = memory;
-    alloc->total_size = actual_size;
-    alloc->min_order = 5; // Минимальный блок 32 байта
-    
-    BuddyBlock* block = (BuddyBlock*)memory;
-    block->size = actual_size;
-    block->free = true;
-    block->next = NULL;
-    
-    size_t level = get_level(actual_size);
-    alloc->free_lists[level] = block;
+
+    // Используем наибольшую степень двойки, которая помещается в арену
+    size_t usable = (uintptr_t)memory + size - start;
+    alloc->memory = (void*)start;
+    alloc->min_order = min_order;
+    alloc->max_order = get_level(usable);
+    alloc->total_size = (size_t)1 << alloc->max_order;
+
+    size_t words = 0;
+    for (size_t order = min_order; order <= alloc->max_order; order++) {
+        words += 2 * (((alloc->total_size >> order) + 63) / 64);
+    }
+    size_t large_blocks = 0;
+    for (size_t order = SMALL_SLACK_ORDER + 1; order <= alloc->max_order; order++) {
+        large_blocks += alloc->total_size >> order;
+    }
+    size_t min_blocks = alloc->total_size >> min_order;
+    alloc->metadata = calloc(1, (words + large_blocks) * sizeof(uint64_t) +
+                                min_blocks * sizeof(uint16_t));
+    if (!alloc->metadata) {
+        free(alloc);
+        return NULL;
+    }
+
+    uint64_t* cursor = alloc->metadata;
+    for (size_t order = min_order; order <= alloc->max_order; order++) {
+        size_t order_words = ((alloc->total_size >> order) + 63) / 64;
+        alloc->free_map[order] = cursor;
+        alloc->split_map[order] = cursor + order_words;
+        cursor += 2 * order_words;
+    }
+    size_t* large = (size_t*)cursor;
+    for (size_t order = SMALL_SLACK_ORDER + 1; order <= alloc->max_order; order++) {
+        alloc->large_slack[order] = large;
+        large += alloc->total_size >> order;
+    }
+    alloc->slack = (uint16_t*)large;
+
+    push_free(alloc, alloc->max_order, 0);
     alloc->total_requested = 0;
     alloc->total_allocated = 0;
-    
+
     return (Allocator*)alloc;
 }
 
 void allocator_destroy(Allocator* allocator) {
-    free((BuddyAllocator*)allocator);
+    BuddyAllocator* alloc = (BuddyAllocator*)allocator;
+    free(alloc->metadata);
+    free(alloc);
 }
 
-void* allocator_alloc(Allocator* allocator, size_t size) {
-    BuddyAllocator* alloc = (BuddyAllocator*)allocator;
-    size_t required = size + sizeof(BuddyBlock);
-    size_t block_size = next_pow2(required);
-    
-    if (block_size < (1u << alloc->min_order)) {
-        block_size = 1u << alloc->min_order;
-    }
-    
-    size_t level = get_level(block_size);
-    if (level >= 32) return NULL;
-    
-    int current_level = level;
-    while (current_level < 32 && !alloc->free_lists[current_level]) {
-        current_level++;
-    }
-    
-    if (current_level >= 32) return NULL;
-    
-    BuddyBlock* block = alloc->free_lists[current_level];
+static size_t level_for(BuddyAllocator* alloc, size_t size) {
+    size_t level = get_level(next_pow2(size));
+    return level < alloc->min_order ? alloc->min_order : level;
+}
+
+static inline void set_slack(BuddyAllocator* alloc, size_t level, size_t index, size_t size) {
+    size_t slack = ((size_t)1 << level) - size;
+    if (level <= SMALL_SLACK_ORDER) {
+        alloc->slack[(index << level) >> alloc->min_order] = (uint16_t)slack;
+    } else {
+        alloc->large_slack[level][index] = slack;
+    }
+}
+
+static inline void update_peaks(BuddyAllocator* alloc) {
+    if (alloc->total_requested > alloc->peak_requested) alloc->peak_requested = alloc->total_requested;
+    if (alloc->total_allocated > alloc->peak_allocated) alloc->peak_allocated = alloc->total_allocated;
+}
+
+static void* alloc_level(BuddyAllocator* alloc, size_t level, size_t size) {
+    // Первый непустой список не меньше нужного порядка
+    uint64_t candidates = alloc->nonempty & (~0ull << level);
+    if (!candidates) return NULL;
+    size_t current_level = __builtin_ctzll(candidates);
+
+    size_t index = pop_free(alloc, current_level);
     while (current_level > level) {
-        alloc->free_lists[current_level] = block->next;
+        set_bit(alloc->split_map[current_level], index);
         current_level--;
-        size_t new_size = block->size / 2;
-        
-        BuddyBlock* buddy = (BuddyBlock*)((char*)block + new_size);
-        block->size = new_size;
-        buddy->size = new_size;
-        block->free = true;
-        buddy->free = true;
-        
-        block->next = alloc->free_lists[current_level];
-        buddy->next = alloc->free_lists[current_level];
-        alloc->free_lists[current_level] = block;
-        alloc->free_lists[current_level] = buddy;
-        
-        block = alloc->free_lists[current_level];
-    }
-    
-    alloc->free_lists[current_level] = block->next;
-    block->free = false;
+        index <<= 1;
+        push_free(alloc, current_level, index | 1);
+    }
+
+    set_slack(alloc, level, index, size);
     alloc->total_requested += size;
-    alloc->total_allocated += block->size + sizeof(BuddyBlock);
-    return (void*)(block + 1);
+    alloc->total_allocated += (size_t)1 << level;
+    alloc->live_blocks++;
+    update_peaks(alloc);
+    return block_at(alloc, level, index);
+}
+
+void* allocator_alloc(Allocator* allocator, size_t size) {
+    BuddyAllocator* alloc = (BuddyAllocator*)allocator;
+    if (size == 0 || size > alloc->total_size) return NULL;
+    return alloc_level(alloc, level_for(alloc, size), size);
+}
+
+// Находит занятый блок по указателю.
+// false - указатель не является началом занятого блока
+static bool find_block(BuddyAllocator* alloc, void* ptr, size_t* level_out, size_t* index_out) {
+    if ((char*)ptr < (char*)alloc->memory ||
+        (char*)ptr >= (char*)alloc->memory + alloc->total_size) {
+        return false;
+    }
+
+    // Поднимаемся от минимального порядка, пока родитель не разделён:
+    // внутри занятого блока биты разделения сброшены, так что первый
+    // разделённый родитель указывает на сам блок. Для мелких блоков - O(1)
+    size_t offset = (char*)ptr - (char*)alloc->memory;
+    size_t level = alloc->min_order;
+    while (level < alloc->max_order && !test_bit(alloc->split_map[level + 1], offset >> (level + 1))) {
+        level++;
+    }
+    size_t index = offset >> level;
+    if ((index << level) != offset || test_bit(alloc->free_map[level], index)) {
+        return false; // Не начало блока или повторное освобождение
+    }
+
+    *level_out = level;
+    *index_out = index;
+    return true;
+}
+
+static inline size_t block_requested(BuddyAllocator* alloc, size_t level, size_t index) {
+    size_t slack = level <= SMALL_SLACK_ORDER ? alloc->slack[(index << level) >> alloc->min_order]
+                                              : alloc->large_slack[level][index];
+    return ((size_t)1 << level) - slack;
+}
+
+// То же, но блок снимается со статистики перед освобождением
+static bool take_block(BuddyAllocator* alloc, void* ptr, size_t* level_out, size_t* index_out) {
+    if (!find_block(alloc, ptr, level_out, index_out)) return false;
+    alloc->total_requested -= block_requested(alloc, *level_out, *index_out);
+    alloc->total_allocated -= (size_t)1 << *level_out;
+    alloc->live_blocks--;
+    return true;
+}
+
+// Сливает блок со свободными приятелями и кладёт в список
+static void release_block(BuddyAllocator* alloc, size_t level, size_t index) {
+    while (level < alloc->max_order && test_bit(alloc->free_map[level], index ^ 1)) {
+        remove_free(alloc, level, index ^ 1);
+        level++;
+        index >>= 1;
+        clear_bit(alloc->split_map[level], index);
+    }
+
+    push_free(alloc, level, index);
 }
 
 void allocator_free(Allocator* allocator, void* ptr) {
     if (!ptr) return;
-    
+
     BuddyAllocator* alloc = (BuddyAllocator*)allocator;
-    BuddyBlock* block = (BuddyBlock*)ptr - 1;
-    block->free = true;
-    
-    alloc->total_requested -= block->size;
-    alloc->total_allocated -= block->size + sizeof(BuddyBlock);
-    
-    size_t current_size = block->size;
-    while (1) {
-        size_t level = get_level(current_size);
-        BuddyBlock* buddy = (BuddyBlock*)((uintptr_t)block ^ current_size);
-        
-        if ((uintptr_t)buddy < (uintptr_t)alloc->memory || 
-            (uintptr_t)buddy + current_size > (uintptr_t)alloc->memory + alloc->total_size ||
-            !buddy->free || buddy->size != current_size) {
-            break;
+    size_t level, index;
+    if (take_block(alloc, ptr, &level, &index)) {
+        release_block(alloc, level, index);
+    }
+}
+
+size_t allocator_alloc_batch(Allocator* allocator, size_t size, void** out, size_t n) {
+    BuddyAllocator* alloc = (BuddyAllocator*)allocator;
+    if (size == 0 || size > alloc->total_size) return 0;
+
+    size_t level = level_for(alloc, size);
+    size_t block_size = (size_t)1 << level;
+
+    size_t done = 0;
+    while (done < n) {
+        uint64_t candidates = alloc->nonempty & (~0ull << level);
+        if (!candidates) break;
+        size_t current_level = __builtin_ctzll(candidates);
+        size_t index = pop_free(alloc, current_level);
+
+        // Делим, пока блок вмещает больше, чем нужно оставшейся части пакета
+        while (current_level > level && ((size_t)1 << (current_level - level)) > n - done) {
+            set_bit(alloc->split_map[current_level], index);
+            current_level--;
+            index <<= 1;
+            push_free(alloc, current_level, index | 1);
+        }
+
+        // Оставшийся блок целиком нарезается на блоки нужного размера
+        for (size_t order = current_level; order > level; order--) {
+            size_t first = index << (current_level - order);
+            size_t count = (size_t)1 << (current_level - order);
+            for (size_t i = 0; i < count; i++) {
+                set_bit(alloc->split_map[order], first + i);
+            }
+        }
+
+        size_t first = index << (current_level - level);
+        size_t count = (size_t)1 << (current_level - level);
+        for (size_t i = 0; i < count; i++) {
+            void* ptr = block_at(alloc, level, first + i);
+            set_slack(alloc, level, first + i, size);
+            out[done++] = ptr;
+        }
+        alloc->total_requested += count * size;
+        alloc->total_allocated += count * block_size;
+        alloc->live_blocks += count;
+    }
+    update_peaks(alloc);
+    return done;
+}
+
+static int compare_ptrs(const void* a, const void* b) {
+    uintptr_t x = (uintptr_t)*(void* const*)a;
+    uintptr_t y = (uintptr_t)*(void* const*)b;
+    return (x > y) - (x < y);
+}
+
+// Пакеты обычно освобождают в порядке выделения - тогда сортировка не нужна.
+// Сортирует массив вызывающего на месте, как и обещает allocator.h
+static void sort_ptrs(void** ptrs, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        if ((uintptr_t)ptrs[i] < (uintptr_t)ptrs[i - 1]) {
+            qsort(ptrs, n, sizeof(void*), compare_ptrs);
+            return;
+        }
+    }
+}
+
+typedef struct {
+    size_t level;
+    size_t index;
+} PendingBlock;
+
+void allocator_free_batch(Allocator* allocator, void** ptrs, size_t n) {
+    BuddyAllocator* alloc = (BuddyAllocator*)allocator;
+    sort_ptrs(ptrs, n);
+
+    // После сортировки приятели из пакета идут подряд и сливаются на стеке,
+    // не попадая в списки. В стеке остаются только левые половины, чей
+    // приятель ещё может встретиться дальше; их уровни строго убывают
+    PendingBlock stack[MAX_ORDERS];
+    size_t top = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        size_t level, index;
+        if (!ptrs[i] || !take_block(alloc, ptrs[i], &level, &index)) continue;
+        size_t offset = index << level;
+
+        while (top > 0) {
+            PendingBlock* pending = &stack[top - 1];
+            size_t buddy_start = (pending->index + 1) << pending->level;
+            size_t buddy_end = buddy_start + ((size_t)1 << pending->level);
+            if (offset >= buddy_start && offset < buddy_end) break;
+            release_block(alloc, pending->level, pending->index);
+            top--;
+        }
+        stack[top++] = (PendingBlock){level, index};
+
+        while (top >= 2 &&
+               stack[top - 2].level == stack[top - 1].level &&
+               stack[top - 2].index == (stack[top - 1].index ^ 1)) {
+            top--;
+            PendingBlock* merged = &stack[top - 1];
+            merged->level++;
+            merged->index >>= 1;
+            clear_bit(alloc->split_map[merged->level], merged->index);
+        }
+
+        // Правой половине или корню сливаться внутри пакета уже не с кем
+        PendingBlock* last = &stack[top - 1];
+        if ((last->index & 1) || last->level == alloc->max_order) {
+            release_block(alloc, last->level, last->index);
+            top--;
+        }
+    }
+
+    while (top > 0) {
+        top--;
+        release_block(alloc, stack[top].level, stack[top].index);
+    }
+}
+
+void* allocator_realloc(Allocator* allocator, void* ptr, size_t size) {
+    BuddyAllocator* alloc = (BuddyAllocator*)allocator;
+    if (size > alloc->total_size) return NULL;
+    if (!ptr) return size ? alloc_level(alloc, level_for(alloc, size), size) : NULL;
+
+    size_t level, index;
+    if (size == 0) {
+        if (take_block(alloc, ptr, &level, &index)) release_block(alloc, level, index);
+        return NULL;
+    }
+    if (!find_block(alloc, ptr, &level, &index)) return NULL;
+    size_t old_requested = block_requested(alloc, level, index);
+    size_t new_level = level_for(alloc, size);
+    size_t old_block = (size_t)1 << level;
+
+    if (new_level > level) {
+        // Растём на месте, только если блок - левая половина на каждом
+        // уровне, а правая целиком свободна
+        size_t l = level, i = index;
+        while (l < new_level && !(i & 1) && test_bit(alloc->free_map[l], i ^ 1)) {
+            l++;
+            i >>= 1;
+        }
+        if (l < new_level) {
+            void* moved = alloc_level(alloc, new_level, size);
+            if (!moved) return NULL;
+            memcpy(moved, ptr, old_requested);
+            take_block(alloc, ptr, &level, &index);
+            release_block(alloc, level, index);
+            return moved;
+        }
+
+        while (level < new_level) {
+            remove_free(alloc, level, index ^ 1);
+            level++;
+            index >>= 1;
+            clear_bit(alloc->split_map[level], index);
         }
-        
-        BuddyBlock** prev = &alloc->free_lists[level];
-        while (*prev && *prev != buddy) prev = &(*prev)->next;
-        if (*prev) *prev = buddy->next;
-        
-        block = (block < buddy) ? block : buddy;
-        current_size *= 2;
-        block->size = current_size;
     }
-    
-    size_t final_level = get_level(current_size);
-    block->next = alloc->free_lists[final_level];
-    alloc->free_lists[final_level] = block;
+
+    // Уменьшение: отдаём правые половины, блок остаётся на месте
+    while (level > new_level) {
+        set_bit(alloc->split_map[level], index);
+        level--;
+        index <<= 1;
+        release_block(alloc, level, index | 1);
+    }
+
+    alloc->total_allocated = alloc->total_allocated - old_block + ((size_t)1 << level);
+    alloc->total_requested = alloc->total_requested - old_requested + size;
+    update_peaks(alloc);
+    set_slack(alloc, level, index, size);
+    return ptr;
+}
+
+void* allocator_aligned_alloc(Allocator* allocator, size_t alignment, size_t size) {
+    BuddyAllocator* alloc = (BuddyAllocator*)allocator;
+    if (size == 0 || size > alloc->total_size || alignment == 0 || (alignment & (alignment - 1))) {
+        return NULL;
+    }
+
+    // Блок порядка k выровнен на 2^k относительно начала арены, поэтому
+    // достаточно взять блок не меньше выравнивания
+    if ((uintptr_t)alloc->memory % alignment) return NULL;
+    size_t level = level_for(alloc, size > alignment ? size : alignment);
+    if (((size_t)1 << level) > alloc->total_size) return NULL;
+    return alloc_level(alloc, level, size);
 }
 
 AllocatorStats allocator_get_stats(Allocator* allocator) {
@@ -142,4 +460,48 @@ AllocatorStats allocator_get_stats(Allocator* allocator) {
         .requested = alloc->total_requested,
         .allocated = alloc->total_allocated
     };
-}
\ No newline at end of file
+}
+
+void allocator_get_info(Allocator* allocator, AllocatorInfo* info) {
+    BuddyAllocator* alloc = (BuddyAllocator*)allocator;
+    memset(info, 0, sizeof(AllocatorInfo));
+    info->live_requested = alloc->total_requested;
+    info->live_allocated = alloc->total_allocated;
+    info->live_blocks = alloc->live_blocks;
+    info->peak_requested = alloc->peak_requested;
+    info->peak_allocated = alloc->peak_allocated;
+    info->free_bytes = alloc->total_size - alloc->total_allocated;
+
+    for (size_t order = alloc->min_order; order <= alloc->max_order; order++) {
+        AllocatorClassInfo* cls = &info->classes[info->num_classes++];
+        cls->block_size = (size_t)1 << order;
+        cls->free_blocks = alloc->free_count[order];
+        cls->largest_free = cls->free_blocks ? cls->block_size : 0;
+        info->free_blocks += cls->free_blocks;
+    }
+    if (alloc->nonempty) {
+        info->largest_free = (size_t)1 << (63 - __builtin_clzll(alloc->nonempty));
+    }
+    if (info->free_bytes) {
+        info->external_fragmentation = 1.0 - (double)info->largest_free / info->free_bytes;
+    }
+}
+
+// Спуск по битам разделения: левое поддерево раньше правого,
+// поэтому блоки идут по возрастанию адресов
+static int walk_block(BuddyAllocator* alloc, size_t level, size_t index,
+                      AllocatorWalkFunc callback, void* arg) {
+    if (test_bit(alloc->free_map[level], index)) {
+        return callback(block_at(alloc, level, index), (size_t)1 << level, 0, arg);
+    }
+    if (level > alloc->min_order && test_bit(alloc->split_map[level], index)) {
+        return walk_block(alloc, level - 1, index << 1, callback, arg) ||
+               walk_block(alloc, level - 1, (index << 1) | 1, callback, arg);
+    }
+    return callback(block_at(alloc, level, index), (size_t)1 << level, 1, arg);
+}
+
+void allocator_walk(Allocator* allocator, AllocatorWalkFunc callback, void* arg) {
+    BuddyAllocator* alloc = (BuddyAllocator*)allocator;
+    walk_block(alloc, alloc->max_order, 0, callback, arg);
+}
@@ -0,0 +1,369 @@
+#include "allocator.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// Неблокирующий buddy-аллокатор (схема NBBS). Арена - полное двоичное
+// дерево, у каждого узла байт состояния: занят целиком, заняты ли левое и
+// правое поддеревья и идёт ли в них слияние. Выделение захватывает узел
+// CAS'ом и помечает предков вверх до корня, освобождение снимает пометки,
+// пока у предка не окажется занятого приятеля. Потоки начинают поиск с
+// разных мест уровня и поэтому работают в разных поддеревьях без блокировок.
+
+#define OCC_RIGHT 0x01
+#define OCC_LEFT 0x02
+#define COAL_RIGHT 0x04
+#define COAL_LEFT 0x08
+#define OCC 0x10
+#define BUSY (OCC | OCC_LEFT | OCC_RIGHT)
+
+#define MAX_DEPTH 63
+#define STAT_STRIPES 16
+#define PEAK_INTERVAL 64       // Раз во столько выделений поток обновляет максимумы
+
+// Экспортируется, чтобы main не оборачивал аллокатор мьютексом
+const int allocator_thread_safe = 1;
+
+typedef struct {
+    _Alignas(64) atomic_size_t requested;
+    atomic_size_t allocated;
+    atomic_size_t blocks;
+    atomic_size_t free_blocks[MAX_DEPTH + 1];   // Свободные блоки по глубине, кроме корня
+} StatStripe;
+
+typedef struct {
+    void* memory;
+    size_t total_size;
+    size_t min_order;
+    size_t max_depth;              // Глубина листьев (минимальных блоков)
+    _Atomic uint8_t* tree;         // Узлы 1..2^(max_depth+1)-1, корень - 1
+    uint8_t* leaf_depth;           // Глубина выданного блока по номеру листа
+    uint32_t* slack;               // Размер блока минус запрошенный
+    StatStripe stats[STAT_STRIPES];
+    _Alignas(64) atomic_size_t peak_requested;
+    atomic_size_t peak_allocated;
+} LockFreeBuddyAllocator;
+
+static atomic_uint next_thread = 0;
+static __thread unsigned thread_no = UINT32_MAX;
+static __thread size_t last_node[MAX_DEPTH + 1];
+static __thread unsigned peak_countdown;
+
+static size_t next_pow2(size_t size) {
+    if (size <= 1) return 1;
+    return 1ull << (64 - __builtin_clzl(size - 1));
+}
+
+static size_t get_level(size_t size) {
+    return 64 - __builtin_clzl(size) - 1;
+}
+
+static inline size_t depth_of(size_t node) {
+    return get_level(node);
+}
+
+static inline bool is_left(size_t node) {
+    return (node & 1) == 0;
+}
+
+static inline uint8_t occ_bit(size_t child) {
+    return is_left(child) ? OCC_LEFT : OCC_RIGHT;
+}
+
+static inline uint8_t coal_bit(size_t child) {
+    return is_left(child) ? COAL_LEFT : COAL_RIGHT;
+}
+
+static inline bool is_occ_buddy(uint8_t value, size_t child) {
+    return value & (is_left(child) ? OCC_RIGHT : OCC_LEFT);
+}
+
+static inline bool is_coal_buddy(uint8_t value, size_t child) {
+    return value & (is_left(child) ? COAL_RIGHT : COAL_LEFT);
+}
+
+static unsigned current_thread(void) {
+    if (thread_no == UINT32_MAX) thread_no = atomic_fetch_add(&next_thread, 1);
+    return thread_no;
+}
+
+// Свободный блок - это ребёнок узла, у которого занят ровно один ребёнок
+// (или корень, если дерево пусто). Поэтому счётчики свободных блоков
+// меняются только там, где CAS меняет биты занятости детей у узла
+static inline bool one_child_occupied(uint8_t value) {
+    uint8_t occ = value & (OCC_LEFT | OCC_RIGHT);
+    return occ == OCC_LEFT || occ == OCC_RIGHT;
+}
+
+static void count_free(StatStripe* stripe, size_t node, uint8_t old_value, uint8_t new_value) {
+    int delta = (int)one_child_occupied(new_value) - (int)one_child_occupied(old_value);
+    if (delta == 0) return;
+    atomic_fetch_add_explicit(&stripe->free_blocks[depth_of(node) + 1], (size_t)(ptrdiff_t)delta,
+                              memory_order_relaxed);
+}
+
+// Снимаем пометки занятости с предков узла, пока приятель свободен
+static void unmark(LockFreeBuddyAllocator* alloc, size_t node, size_t upper_depth, StatStripe* stripe) {
+    size_t current = node;
+    size_t child;
+    uint8_t value, new_value;
+    do {
+        child = current;
+        current >>= 1;
+        value = atomic_load(&alloc->tree[current]);
+        do {
+            // Бит слияния сброшен - поддерево уже снова кем-то занято
+            if (!(value & coal_bit(child))) return;
+            new_value = value & ~(occ_bit(child) | coal_bit(child));
+        } while (!atomic_compare_exchange_weak(&alloc->tree[current], &value, new_value));
+        count_free(stripe, current, value, new_value);
+    } while (depth_of(current) > upper_depth && !is_occ_buddy(new_value, child));
+}
+
+static void free_node(LockFreeBuddyAllocator* alloc, size_t node, size_t upper_depth, StatStripe* stripe) {
+    // Сначала объявляем слияние на пути вверх, затем освобождаем узел
+    size_t runner = node;
+    size_t current = node >> 1;
+    while (depth_of(runner) > upper_depth) {
+        uint8_t old = atomic_fetch_or(&alloc->tree[current], coal_bit(runner));
+        if (is_occ_buddy(old, runner) && !is_coal_buddy(old, runner)) break;
+        runner = current;
+        current >>= 1;
+    }
+    atomic_store(&alloc->tree[node], 0);
+    if (depth_of(node) != upper_depth) unmark(alloc, node, upper_depth, stripe);
+}
+
+// 0 - узел захвачен, иначе номер узла, из-за которого не получилось
+static size_t try_alloc(LockFreeBuddyAllocator* alloc, size_t node, StatStripe* stripe) {
+    uint8_t expected = 0;
+    if (!atomic_compare_exchange_strong(&alloc->tree[node], &expected, BUSY)) return node;
+
+    size_t current = node;
+    while (current > 1) {
+        size_t child = current;
+        current >>= 1;
+        uint8_t value = atomic_load(&alloc->tree[current]);
+        uint8_t new_value;
+        do {
+            if (value & OCC) {
+                free_node(alloc, node, depth_of(child), stripe);
+                return current;
+            }
+            new_value = (value & ~coal_bit(child)) | occ_bit(child);
+        } while (!atomic_compare_exchange_weak(&alloc->tree[current], &value, new_value));
+        count_free(stripe, current, value, new_value);
+    }
+    return 0;
+}
+
+static void sum_stats(LockFreeBuddyAllocator* alloc, size_t* requested, size_t* allocated, size_t* blocks) {
+    // Полосы складываются по модулю 2^64, поэтому сумма корректна,
+    // даже если освобождал не тот поток, что выделял
+    *requested = *allocated = *blocks = 0;
+    for (int i = 0; i < STAT_STRIPES; i++) {
+        *requested += atomic_load_explicit(&alloc->stats[i].requested, memory_order_relaxed);
+        *allocated += atomic_load_explicit(&alloc->stats[i].allocated, memory_order_relaxed);
+        *blocks += atomic_load_explicit(&alloc->stats[i].blocks, memory_order_relaxed);
+    }
+}
+
+static void raise_peak(atomic_size_t* peak, size_t value) {
+    size_t current = atomic_load_explicit(peak, memory_order_relaxed);
+    while (value > current &&
+           !atomic_compare_exchange_weak_explicit(peak, &current, value,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+// Общий счётчик на каждое выделение свёл бы полосы на нет, поэтому
+// максимумы выборочные и могут пропустить пик короче PEAK_INTERVAL выделений
+static void update_peaks(LockFreeBuddyAllocator* alloc) {
+    size_t requested, allocated, blocks;
+    sum_stats(alloc, &requested, &allocated, &blocks);
+    raise_peak(&alloc->peak_requested, requested);
+    raise_peak(&alloc->peak_allocated, allocated);
+}
+
+Allocator* allocator_create(void* memory, size_t size) {
+    const size_t min_order = 5; // Минимальный блок 32 байта
+    uintptr_t start = ((uintptr_t)memory + (1u << min_order) - 1) & ~(uintptr_t)((1u << min_order) - 1);
+    if ((uintptr_t)memory + size <= start + (1u << min_order)) {
+        fprintf(stderr, "Memory size too small\n");
+        return NULL;
+    }
+
+    LockFreeBuddyAllocator* alloc = aligned_alloc(64, sizeof(LockFreeBuddyAllocator));
+    if (!alloc) return NULL;
+    memset(alloc, 0, sizeof(LockFreeBuddyAllocator));
+
+    size_t usable = (uintptr_t)memory + size - start;
+    alloc->memory = (void*)start;
+    alloc->total_size = (size_t)1 << get_level(usable);
+    alloc->min_order = min_order;
+    alloc->max_depth = get_level(alloc->total_size) - min_order;
+
+    size_t leaves = (size_t)1 << alloc->max_depth;
+    alloc->tree = calloc(2 * leaves, sizeof(uint8_t));
+    alloc->leaf_depth = calloc(leaves, sizeof(uint8_t));
+    alloc->slack = malloc(leaves * sizeof(uint32_t));
+    if (!alloc->tree || !alloc->leaf_depth || !alloc->slack) {
+        free((void*)alloc->tree);
+        free(alloc->leaf_depth);
+        free(alloc->slack);
+        free(alloc);
+        return NULL;
+    }
+    return (Allocator*)alloc;
+}
+
+void allocator_destroy(Allocator* allocator) {
+    LockFreeBuddyAllocator* alloc = (LockFreeBuddyAllocator*)allocator;
+    free((void*)alloc->tree);
+    free(alloc->leaf_depth);
+    free(alloc->slack);
+    free(alloc);
+}
+
+void* allocator_alloc(Allocator* allocator, size_t size) {
+    LockFreeBuddyAllocator* alloc = (LockFreeBuddyAllocator*)allocator;
+    if (size == 0 || size > alloc->total_size) return NULL;
+
+    size_t block_size = next_pow2(size);
+    if (block_size < ((size_t)1 << alloc->min_order)) block_size = (size_t)1 << alloc->min_order;
+    size_t depth = get_level(alloc->total_size) - get_level(block_size);
+
+    size_t first = (size_t)1 << depth;
+    size_t count = first;
+    unsigned thread = current_thread();
+    StatStripe* stripe = &alloc->stats[thread % STAT_STRIPES];
+
+    // Продолжаем с места прошлого успеха, новый поток - со своей доли уровня
+    size_t offset = 0;
+    if (last_node[depth] >= first && last_node[depth] < 2 * first) {
+        offset = last_node[depth] - first;
+    } else if (depth > 0) {
+        offset = (size_t)(((uint64_t)thread * 0x9E3779B97F4A7C15ull) >> (64 - depth));
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        size_t node = first + ((offset + i) & (count - 1));
+        if (atomic_load_explicit(&alloc->tree[node], memory_order_relaxed) != 0) continue;
+
+        size_t blocker = try_alloc(alloc, node, stripe);
+        if (blocker == 0) {
+            last_node[depth] = node;
+            size_t leaf = (node - first) << (alloc->max_depth - depth);
+            alloc->leaf_depth[leaf] = (uint8_t)depth;
+            alloc->slack[leaf] = (uint32_t)(block_size - size > UINT32_MAX ? UINT32_MAX : block_size - size);
+
+            atomic_fetch_add_explicit(&stripe->requested, size, memory_order_relaxed);
+            atomic_fetch_add_explicit(&stripe->allocated, block_size, memory_order_relaxed);
+            atomic_fetch_add_explicit(&stripe->blocks, 1, memory_order_relaxed);
+            if (peak_countdown-- == 0) {
+                peak_countdown = PEAK_INTERVAL - 1;
+                update_peaks(alloc);
+            }
+            return (char*)alloc->memory + ((node - first) * block_size);
+        }
+
+        // Занят предок - пропускаем остаток его поддерева на этом уровне
+        if (blocker != node) {
+            size_t subtree_end = (blocker + 1) << (depth - depth_of(blocker));
+            size_t skip = subtree_end - node - 1;
+            i += skip < count - i ? skip : count - i;
+        }
+    }
+    return NULL;
+}
+
+void allocator_free(Allocator* allocator, void* ptr) {
+    LockFreeBuddyAllocator* alloc = (LockFreeBuddyAllocator*)allocator;
+    if (!ptr) return;
+    if ((char*)ptr < (char*)alloc->memory ||
+        (char*)ptr >= (char*)alloc->memory + alloc->total_size) {
+        return;
+    }
+
+    size_t offset = (char*)ptr - (char*)alloc->memory;
+    size_t leaf = offset >> alloc->min_order;
+    size_t depth = alloc->leaf_depth[leaf];
+    size_t block_size = alloc->total_size >> depth;
+    size_t node = ((size_t)1 << depth) + (leaf >> (alloc->max_depth - depth));
+
+    // Как take_block в buddy.c: не начало блока или повторное освобождение
+    // пропускаем. OCC стоит только у выданных узлов, а leaf_depth листа,
+    // с которого начинается выданный узел, всегда указывает на него
+    if ((offset & (block_size - 1)) ||
+        !(atomic_load_explicit(&alloc->tree[node], memory_order_relaxed) & OCC)) {
+        return;
+    }
+
+    StatStripe* stripe = &alloc->stats[current_thread() % STAT_STRIPES];
+    atomic_fetch_sub_explicit(&stripe->requested, block_size - alloc->slack[leaf], memory_order_relaxed);
+    atomic_fetch_sub_explicit(&stripe->allocated, block_size, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&stripe->blocks, 1, memory_order_relaxed);
+
+    free_node(alloc, node, 0, stripe);
+}
+
+AllocatorStats allocator_get_stats(Allocator* allocator) {
+    LockFreeBuddyAllocator* alloc = (LockFreeBuddyAllocator*)allocator;
+    AllocatorStats stats;
+    size_t blocks;
+    sum_stats(alloc, &stats.requested, &stats.allocated, &blocks);
+    return stats;
+}
+
+void allocator_get_info(Allocator* allocator, AllocatorInfo* info) {
+    LockFreeBuddyAllocator* alloc = (LockFreeBuddyAllocator*)allocator;
+    memset(info, 0, sizeof(AllocatorInfo));
+    update_peaks(alloc);
+    sum_stats(alloc, &info->live_requested, &info->live_allocated, &info->live_blocks);
+    info->peak_requested = atomic_load_explicit(&alloc->peak_requested, memory_order_relaxed);
+    info->peak_allocated = atomic_load_explicit(&alloc->peak_allocated, memory_order_relaxed);
+
+    // Счётчики из count_free, без обхода дерева. При параллельных
+    // alloc/free картина приблизительная. Классы по возрастанию размера,
+    // как у обычного buddy
+    info->num_classes = alloc->max_depth + 1;
+    for (size_t depth = 0; depth <= alloc->max_depth; depth++) {
+        AllocatorClassInfo* cls = &info->classes[alloc->max_depth - depth];
+        cls->block_size = alloc->total_size >> depth;
+        if (depth == 0) {
+            uint8_t root = atomic_load_explicit(&alloc->tree[1], memory_order_relaxed);
+            cls->free_blocks = (root & BUSY) == 0;
+        } else {
+            for (int i = 0; i < STAT_STRIPES; i++) {
+                cls->free_blocks += atomic_load_explicit(&alloc->stats[i].free_blocks[depth],
+                                                         memory_order_relaxed);
+            }
+        }
+        cls->largest_free = cls->free_blocks ? cls->block_size : 0;
+        info->free_blocks += cls->free_blocks;
+        info->free_bytes += cls->free_blocks * cls->block_size;
+        if (cls->largest_free > info->largest_free) info->largest_free = cls->largest_free;
+    }
+    if (info->free_bytes) {
+        info->external_fragmentation = 1.0 - (double)info->largest_free / info->free_bytes;
+    }
+}
+
+static int walk_node(LockFreeBuddyAllocator* alloc, size_t node, size_t depth,
+                     AllocatorWalkFunc callback, void* arg) {
+    uint8_t value = atomic_load_explicit(&alloc->tree[node], memory_order_relaxed);
+    size_t block_size = alloc->total_size >> depth;
+    char* ptr = (char*)alloc->memory + (node - ((size_t)1 << depth)) * block_size;
+    if (value == 0) return callback(ptr, block_size, 0, arg);
+    if ((value & OCC) || depth == alloc->max_depth) return callback(ptr, block_size, 1, arg);
+    return walk_node(alloc, 2 * node, depth + 1, callback, arg) ||
+           walk_node(alloc, 2 * node + 1, depth + 1, callback, arg);
+}
+
+void allocator_walk(Allocator* allocator, AllocatorWalkFunc callback, void* arg) {
+    LockFreeBuddyAllocator* alloc = (LockFreeBuddyAllocator*)allocator;
+    walk_node(alloc, 1, 0, callback, arg);
+}
@@ -1,26 +1,115 @@
 #include "allocator.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
+// Граничные теги: заголовок в начале блока и футер с тем же размером
+// в конце, поэтому соседи слева и справа находятся за O(1)
 typedef struct Block {
-    size_t size;
-    struct Block* next;
+    size_t size;            // Размер полезной части блока
     bool free;
+    uint32_t slack;         // Полезная часть минус запрошенное (у занятого)
+    struct Block* next;     // Двусвязный список свободных блоков; указатели
+    struct Block* prev;     // лежат в полезной части и есть только у свободного
 } Block;
 
+typedef struct {
+    size_t size;
+} Footer;
+
+#define ALIGNMENT 16
+#define HEADER_SIZE offsetof(Block, next)
+#define OVERHEAD (HEADER_SIZE + sizeof(Footer))
+#define MIN_PAYLOAD (sizeof(Block) - HEADER_SIZE)
+#define NUM_ORDERS 64       // Классы для get_info: размеры [2^k, 2^(k+1))
+
 typedef struct {
     void* memory;
     size_t total_size;
     Block* free_head;
+    // Сводка по списку для get_info ведётся при каждом включении блока
+    // в список и исключении из него. Наибольший блок класса
+    // пересчитывается обходом, только если он сам ушёл из списка
+    size_t free_count[NUM_ORDERS];
+    size_t largest[NUM_ORDERS];
+    uint64_t stale_largest;     // Классы, у которых largest надо пересчитать
+    size_t free_bytes;
     size_t total_requested;
     size_t total_allocated;
+    size_t live_blocks;
+    size_t peak_requested;
+    size_t peak_allocated;
 } BestFitAllocator;
 
+static inline Footer* block_footer(Block* block) {
+    return (Footer*)((char*)block + HEADER_SIZE + block->size);
+}
+
+static inline void set_size(Block* block, size_t size) {
+    block->size = size;
+    block_footer(block)->size = size;
+}
+
+static inline Block* next_block(BestFitAllocator* alloc, Block* block) {
+    Block* next = (Block*)((char*)block + OVERHEAD + block->size);
+    return (char*)next < (char*)alloc->memory + alloc->total_size ? next : NULL;
+}
+
+static inline Block* prev_block(BestFitAllocator* alloc, Block* block) {
+    if (block == (Block*)alloc->memory) return NULL;
+    Footer* footer = (Footer*)((char*)block - sizeof(Footer));
+    return (Block*)((char*)footer - footer->size - HEADER_SIZE);
+}
+
+static inline size_t size_order(size_t size) {
+    return 63 - __builtin_clzl(size);
+}
+
+static void count_linked(BestFitAllocator* alloc, Block* block) {
+    size_t order = size_order(block->size);
+    alloc->free_count[order]++;
+    if (block->size > alloc->largest[order]) alloc->largest[order] = block->size;
+    alloc->free_bytes += block->size;
+}
+
+static void count_unlinked(BestFitAllocator* alloc, Block* block) {
+    size_t order = size_order(block->size);
+    if (--alloc->free_count[order] == 0) {
+        alloc->largest[order] = 0;
+        alloc->stale_largest &= ~(1ull << order);
+    } else if (block->size == alloc->largest[order]) {
+        alloc->stale_largest |= 1ull << order;
+    }
+    alloc->free_bytes -= block->size;
+}
+
+static void push_free(BestFitAllocator* alloc, Block* block) {
+    count_linked(alloc, block);
+    block->free = true;
+    block->prev = NULL;
+    block->next = alloc->free_head;
+    if (alloc->free_head) alloc->free_head->prev = block;
+    alloc->free_head = block;
+}
+
+static void unlink_free(BestFitAllocator* alloc, Block* block) {
+    count_unlinked(alloc, block);
+    if (block->prev) {
+        block->prev->next = block->next;
+    } else {
+        alloc->free_head = block->next;
+    }
+    if (block->next) block->next->prev = block->prev;
+    block->next = block->prev = NULL;
+}
+
 Allocator* allocator_create(void* memory, size_t size) {
-    if (size < sizeof(Block)) {
+    uintptr_t start = ((uintptr_t)memory + ALIGNMENT - 1) & ~(uintptr_t)(ALIGNMENT - 1);
+    uintptr_t end = ((uintptr_t)memory + size) & ~(uintptr_t)(ALIGNMENT - 1);
+    if (end <= start || end - start < OVERHEAD + MIN_PAYLOAD) {
         fprintf(stderr, "Memory size too small\n");
         return NULL;
     }
@@ -28,17 +117,23 @@ Allocator* allocator_create(void* memory, size_t size) {
     BestFitAllocator* alloc = malloc(sizeof(BestFitAllocator));
     if (!alloc) return NULL;
 
-    alloc->memory = memory;
-    alloc->total_size = size;
-    
-    Block* initial = (Block*)memory;
-    initial->size = size - sizeof(Block);
-    initial->next = NULL;
-    initial->free = true;
-    
-    alloc->free_head = initial;
+    alloc->memory = (void*)start;
+    alloc->total_size = end - start;
+    alloc->free_head = NULL;
+    memset(alloc->free_count, 0, sizeof(alloc->free_count));
+    memset(alloc->largest, 0, sizeof(alloc->largest));
+    alloc->stale_largest = 0;
+    alloc->free_bytes = 0;
+
+    Block* initial = (Block*)alloc->memory;
+    set_size(initial, alloc->total_size - OVERHEAD);
+    push_free(alloc, initial);
+
     alloc->total_requested = 0;
     alloc->total_allocated = 0;
+    alloc->live_blocks = 0;
+    alloc->peak_requested = 0;
+    alloc->peak_allocated = 0;
     
     return (Allocator*)alloc;
 }
@@ -47,95 +142,381 @@ void allocator_destroy(Allocator* allocator) {
     free((BestFitAllocator*)allocator);
 }
 
-void* allocator_alloc(Allocator* allocator, size_t size) {
-    BestFitAllocator* alloc = (BestFitAllocator*)allocator;
-    if (size == 0 || size > alloc->total_size) return NULL;
+// Размер блока целиком кратен выравниванию, чтобы следующий
+// заголовок тоже был выровнен
+static size_t payload_for(size_t size) {
+    size_t payload = ((size + OVERHEAD + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1)) - OVERHEAD;
+    if (payload < MIN_PAYLOAD) payload += ALIGNMENT;
+    return payload;
+}
 
-    Block* best = NULL;
-    Block** best_prev = NULL;
-    Block* current = alloc->free_head;
-    Block** prev = &alloc->free_head;
+// Учёт занятого блока: запрошенный размер восстанавливается по slack
+static void account_used(BestFitAllocator* alloc, Block* block, size_t size) {
+    block->slack = (uint32_t)(block->size - size);
+    alloc->total_requested += size;
+    alloc->total_allocated += block->size + OVERHEAD;
+    alloc->live_blocks++;
+    if (alloc->total_requested > alloc->peak_requested) alloc->peak_requested = alloc->total_requested;
+    if (alloc->total_allocated > alloc->peak_allocated) alloc->peak_allocated = alloc->total_allocated;
+}
+
+static void account_free(BestFitAllocator* alloc, Block* block) {
+    alloc->total_requested -= block->size - block->slack;
+    alloc->total_allocated -= block->size + OVERHEAD;
+    alloc->live_blocks--;
+}
+
+// Сливает освобождённый блок с соседями и кладёт в список
+static void release_block(BestFitAllocator* alloc, Block* block) {
+    // Сосед справа поглощается и удаляется из списка
+    Block* next = next_block(alloc, block);
+    if (next && next->free) {
+        unlink_free(alloc, next);
+        set_size(block, block->size + OVERHEAD + next->size);
+    }
+
+    // Сосед слева уже в списке: достаточно расширить его
+    Block* prev = prev_block(alloc, block);
+    if (prev && prev->free) {
+        count_unlinked(alloc, prev);
+        set_size(prev, prev->size + OVERHEAD + block->size);
+        count_linked(alloc, prev);
+        return;
+    }
+
+    push_free(alloc, block);
+}
+
+// Блок по смещению offset лежит в арене целиком, и футер повторяет
+// размер из заголовка
+static bool tags_agree(BestFitAllocator* alloc, Block* block, size_t offset) {
+    if (offset % ALIGNMENT != 0 || offset > alloc->total_size - OVERHEAD ||
+        block->size > alloc->total_size - OVERHEAD - offset) {
+        return false;
+    }
+    return block_footer(block)->size == block->size;
+}
+
+// Занятый блок, которому принадлежит ptr, или NULL. Граничные теги
+// должны сходиться у самого блока и у соседей: футер соседа слева
+// указывает на заголовок того же размера, заголовок справа начинается
+// сразу за футером. Заголовок блока, который уже слит со свободным
+// соседом слева, так не пройдёт: на месте его футера теперь футер
+// соседа с другим размером
+static Block* used_block(BestFitAllocator* alloc, void* ptr) {
+    Block* block = (Block*)((char*)ptr - HEADER_SIZE);
+    size_t offset = (uintptr_t)block - (uintptr_t)alloc->memory;
+    if (!tags_agree(alloc, block, offset) || block->free) return NULL;
+
+    if (offset > 0) {
+        Footer* footer = (Footer*)((char*)block - sizeof(Footer));
+        if (offset < OVERHEAD || footer->size > offset - OVERHEAD ||
+            prev_block(alloc, block)->size != footer->size) {
+            return NULL;
+        }
+    }
+
+    Block* next = next_block(alloc, block);
+    if (next && !tags_agree(alloc, next, offset + OVERHEAD + block->size)) return NULL;
+    return block;
+}
+
+// Отрезает от блока хвост сверх payload, если из него выйдет отдельный блок
+static void split_tail(BestFitAllocator* alloc, Block* block, size_t payload) {
+    if (block->size >= payload + OVERHEAD + MIN_PAYLOAD) {
+        size_t rest = block->size - payload - OVERHEAD;
+        set_size(block, payload);
+        Block* tail = (Block*)((char*)block + OVERHEAD + payload);
+        set_size(tail, rest);
+        release_block(alloc, tail);
+    }
+}
+
+static void* alloc_block(BestFitAllocator* alloc, size_t size) {
+    size_t payload = payload_for(size);
 
     // Поиск наилучшего блока
-    while (current) {
-        if (current->size >= size) {
-            if (!best || current->size < best->size) {
-                best = current;
-                best_prev = prev;
-            }
+    Block* best = NULL;
+    for (Block* current = alloc->free_head; current; current = current->next) {
+        if (current->size >= payload && (!best || current->size < best->size)) {
+            best = current;
+            if (best->size == payload) break;
         }
-        prev = &current->next;
-        current = current->next;
     }
 
     if (!best) return NULL;
 
-    // Удаляем из списка свободных
-    *best_prev = best->next;
+    unlink_free(alloc, best);
+    best->free = false;
 
     // Разделяем блок при необходимости
-    const size_t required = size + sizeof(Block);
-    if (best->size > required) {
-        Block* new_block = (Block*)((char*)best + required);
-        new_block->size = best->size - required;
-        new_block->free = true;
-        new_block->next = alloc->free_head;
-        alloc->free_head = new_block;
-        
-        best->size = size;
-    }
+    split_tail(alloc, best, payload);
+    account_used(alloc, best, size);
+    return (char*)best + HEADER_SIZE;
+}
 
-    best->free = false;
-    alloc->total_requested += size;
-    alloc->total_allocated += best->size + sizeof(Block);
-    
-    return (void*)(best + 1);
+void* allocator_alloc(Allocator* allocator, size_t size) {
+    BestFitAllocator* alloc = (BestFitAllocator*)allocator;
+    if (size == 0 || size > alloc->total_size) return NULL;
+    return alloc_block(alloc, size);
+}
+
+static void free_block(BestFitAllocator* alloc, Block* block) {
+    account_free(alloc, block);
+    release_block(alloc, block);
 }
 
 void allocator_free(Allocator* allocator, void* ptr) {
     BestFitAllocator* alloc = (BestFitAllocator*)allocator;
     if (!ptr) return;
 
-    Block* block = (Block*)ptr - 1;
-    if ((char*)block < (char*)alloc->memory) return;
+    Block* block = used_block(alloc, ptr);
+    if (block) free_block(alloc, block);
+}
 
-    block->free = true;
+size_t allocator_alloc_batch(Allocator* allocator, size_t size, void** out, size_t n) {
+    BestFitAllocator* alloc = (BestFitAllocator*)allocator;
+    if (size == 0 || size > alloc->total_size) return 0;
+
+    size_t payload = payload_for(size);
+    size_t stride = payload + OVERHEAD;
+    size_t done = 0;
+
+    while (done < n) {
+        // Один проход по списку: наилучший блок под весь остаток пакета,
+        // а если такого нет - самый большой, из него берём сколько влезет
+        size_t left = n - done;
+        size_t want = left > alloc->total_size / stride ? alloc->total_size : left * stride - OVERHEAD;
+        Block* best = NULL;
+        Block* largest = NULL;
+        for (Block* current = alloc->free_head; current; current = current->next) {
+            if (current->size >= want && (!best || current->size < best->size)) best = current;
+            if (!largest || current->size > largest->size) largest = current;
+        }
+
+        Block* region = best ? best : largest;
+        if (!region || region->size < payload) break;
+        unlink_free(alloc, region);
+
+        size_t remaining = region->size + OVERHEAD;
+        size_t count = remaining / stride;
+        if (count > left) count = left;
+
+        char* cursor = (char*)region;
+        for (size_t k = 0; k < count; k++) {
+            size_t block_payload = payload;
+            // Слишком маленький хвост достаётся последнему блоку
+            if (k == count - 1 && remaining - stride < OVERHEAD + MIN_PAYLOAD) {
+                block_payload = remaining - OVERHEAD;
+            }
+
+            Block* block = (Block*)cursor;
+            set_size(block, block_payload);
+            block->free = false;
+            out[done++] = cursor + HEADER_SIZE;
+            account_used(alloc, block, size);
+
+            cursor += block_payload + OVERHEAD;
+            remaining -= block_payload + OVERHEAD;
+        }
+
+        if (remaining > 0) {
+            Block* rest = (Block*)cursor;
+            set_size(rest, remaining - OVERHEAD);
+            push_free(alloc, rest);
+        }
+    }
+    return done;
+}
+
+static int compare_ptrs(const void* a, const void* b) {
+    uintptr_t x = (uintptr_t)*(void* const*)a;
+    uintptr_t y = (uintptr_t)*(void* const*)b;
+    return (x > y) - (x < y);
+}
 
-    Block* prev_block = NULL;
-    if (block != (Block*)alloc->memory) {
-        prev_block = (Block*)((char*)block - sizeof(Block) - ((Block*)((char*)block - sizeof(Block)))->size);
-        if ((char*)prev_block < (char*)alloc->memory || !prev_block->free) {
-            prev_block = NULL;
+// Пакеты обычно освобождают в порядке выделения - тогда сортировка не нужна.
+// Сортирует массив вызывающего на месте, как и обещает allocator.h
+static void sort_ptrs(void** ptrs, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        if ((uintptr_t)ptrs[i] < (uintptr_t)ptrs[i - 1]) {
+            qsort(ptrs, n, sizeof(void*), compare_ptrs);
+            return;
         }
     }
+}
 
-    if (prev_block && (char*)prev_block + sizeof(Block) + prev_block->size == (char*)block) {
-        prev_block->size += sizeof(Block) + block->size;
-        block = prev_block;
+void allocator_free_batch(Allocator* allocator, void** ptrs, size_t n) {
+    BestFitAllocator* alloc = (BestFitAllocator*)allocator;
+    sort_ptrs(ptrs, n);
+
+    // Смежные блоки пакета склеиваются в один участок, и слияние
+    // с соседями делается один раз на участок
+    Block* run = NULL;
+    for (size_t i = 0; i < n; i++) {
+        if (!ptrs[i] || (i > 0 && ptrs[i] == ptrs[i - 1])) continue;
+        Block* block = used_block(alloc, ptrs[i]);
+        if (!block) continue;
+        account_free(alloc, block);
+
+        if (run && (char*)run + OVERHEAD + run->size == (char*)block) {
+            set_size(run, run->size + OVERHEAD + block->size);
+            continue;
+        }
+        if (run) release_block(alloc, run);
+        run = block;
     }
+    if (run) release_block(alloc, run);
+}
 
-    Block* next_block = (Block*)((char*)block + sizeof(Block) + block->size);
-    if ((char*)next_block < (char*)alloc->memory + alloc->total_size && 
-        next_block->free &&
-        (char*)block + sizeof(Block) + block->size == (char*)next_block) {
-        block->size += sizeof(Block) + next_block->size;
+void* allocator_realloc(Allocator* allocator, void* ptr, size_t size) {
+    BestFitAllocator* alloc = (BestFitAllocator*)allocator;
+    if (size > alloc->total_size) return NULL;
+    if (!ptr) return size ? alloc_block(alloc, size) : NULL;
+
+    Block* block = used_block(alloc, ptr);
+    if (!block) return NULL;
+    if (size == 0) {
+        free_block(alloc, block);
+        return NULL;
     }
 
-    block->next = alloc->free_head;
-    alloc->free_head = block;
+    size_t payload = payload_for(size);
+    size_t old_size = block->size;
+    size_t old_requested = block->size - block->slack;
+    Block* next = next_block(alloc, block);
+    size_t next_size = next && next->free ? OVERHEAD + next->size : 0;
+    Block* prev = prev_block(alloc, block);
+    size_t prev_size = prev && prev->free ? OVERHEAD + prev->size : 0;
+
+    if (payload > old_size + next_size) {
+        if (payload > old_size + next_size + prev_size) {
+            // Соседей не хватает - переносим в новый блок
+            void* moved = alloc_block(alloc, size);
+            if (!moved) return NULL;
+            memcpy(moved, ptr, old_requested < size ? old_requested : size);
+            free_block(alloc, block);
+            return moved;
+        }
+
+        // Поглощаем свободного соседа слева и сдвигаем данные в его начало
+        unlink_free(alloc, prev);
+        set_size(prev, prev->size + OVERHEAD + block->size);
+        prev->free = false;
+        memmove((char*)prev + HEADER_SIZE, ptr, old_requested);
+        block = prev;
+        ptr = (char*)block + HEADER_SIZE;
+    }
 
-    alloc->total_requested -= block->size;
-    alloc->total_allocated -= block->size + sizeof(Block);
+    // Поглощаем свободного соседа справа, если без него не хватает
+    if (payload > block->size) {
+        unlink_free(alloc, next);
+        set_size(block, block->size + OVERHEAD + next->size);
+    }
+
+    split_tail(alloc, block, payload);
+
+    alloc->total_requested -= old_requested;
+    alloc->total_allocated -= old_size + OVERHEAD;
+    alloc->live_blocks--;
+    account_used(alloc, block, size);
+    return ptr;
 }
 
-AllocatorStats allocator_get_stats(Allocator* allocator) {
+void* allocator_aligned_alloc(Allocator* allocator, size_t alignment, size_t size) {
     BestFitAllocator* alloc = (BestFitAllocator*)allocator;
-    double utilization = (alloc->total_allocated > 0) 
-        ? (alloc->total_requested * 100.0) / alloc->total_allocated 
-        : 0.0;
+    if (size == 0 || size > alloc->total_size || alignment == 0 || (alignment & (alignment - 1))) {
+        return NULL;
+    }
+    if (alignment <= ALIGNMENT) return alloc_block(alloc, size);
+
+    size_t payload = payload_for(size);
+
+    // Перед выровненным началом должен поместиться свободный блок,
+    // иначе берём следующую границу выравнивания
+    Block* best = NULL;
+    size_t best_gap = 0;
+    for (Block* current = alloc->free_head; current; current = current->next) {
+        uintptr_t start = (uintptr_t)current + HEADER_SIZE;
+        uintptr_t aligned = (start + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        while (aligned != start && aligned - start < OVERHEAD + MIN_PAYLOAD) aligned += alignment;
+        size_t gap = aligned - start;
+        if (current->size >= gap + payload && (!best || current->size < best->size)) {
+            best = current;
+            best_gap = gap;
+        }
+    }
+    if (!best) return NULL;
 
+    unlink_free(alloc, best);
+    if (best_gap) {
+        size_t total = best->size;
+        set_size(best, best_gap - OVERHEAD);
+        push_free(alloc, best);
+        best = (Block*)((char*)best + best_gap);
+        set_size(best, total - best_gap);
+    }
+    best->free = false;
+    split_tail(alloc, best, payload);
+    account_used(alloc, best, size);
+    return (char*)best + HEADER_SIZE;
+}
+
+AllocatorStats allocator_get_stats(Allocator* allocator) {
+    BestFitAllocator* alloc = (BestFitAllocator*)allocator;
     return (AllocatorStats){
         .requested = alloc->total_requested,
         .allocated = alloc->total_allocated
     };
-}
\ No newline at end of file
+}
+
+// Наибольшие блоки классов из stale_largest: один проход по списку,
+// как один поиск best-fit
+static void rescan_largest(BestFitAllocator* alloc) {
+    uint64_t stale = alloc->stale_largest;
+    for (size_t order = 0; order < NUM_ORDERS; order++) {
+        if (stale & (1ull << order)) alloc->largest[order] = 0;
+    }
+    for (Block* block = alloc->free_head; block; block = block->next) {
+        size_t order = size_order(block->size);
+        if ((stale & (1ull << order)) && block->size > alloc->largest[order]) {
+            alloc->largest[order] = block->size;
+        }
+    }
+    alloc->stale_largest = 0;
+}
+
+void allocator_get_info(Allocator* allocator, AllocatorInfo* info) {
+    BestFitAllocator* alloc = (BestFitAllocator*)allocator;
+    memset(info, 0, sizeof(AllocatorInfo));
+    info->live_requested = alloc->total_requested;
+    info->live_allocated = alloc->total_allocated;
+    info->live_blocks = alloc->live_blocks;
+    info->peak_requested = alloc->peak_requested;
+    info->peak_allocated = alloc->peak_allocated;
+
+    // Классов нет, свободные блоки раскладываем по степеням двойки
+    if (alloc->stale_largest) rescan_largest(alloc);
+    size_t min_order = size_order(MIN_PAYLOAD);
+    size_t max_order = size_order(alloc->total_size);
+    for (size_t order = min_order; order <= max_order; order++) {
+        AllocatorClassInfo* cls = &info->classes[info->num_classes++];
+        cls->block_size = (size_t)1 << order;
+        cls->free_blocks = alloc->free_count[order];
+        cls->largest_free = alloc->largest[order];
+        info->free_blocks += cls->free_blocks;
+        if (cls->largest_free > info->largest_free) info->largest_free = cls->largest_free;
+    }
+
+    info->free_bytes = alloc->free_bytes;
+    if (info->free_bytes) {
+        info->external_fragmentation = 1.0 - (double)info->largest_free / info->free_bytes;
+    }
+}
+
+void allocator_walk(Allocator* allocator, AllocatorWalkFunc callback, void* arg) {
+    BestFitAllocator* alloc = (BestFitAllocator*)allocator;
+    for (Block* block = alloc->memory; block; block = next_block(alloc, block)) {
+        if (callback((char*)block + HEADER_SIZE, block->size, !block->free, arg)) return;
+    }
+}
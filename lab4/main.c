@@ -1,9 +1,15 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <dlfcn.h>
 #include <sys/mman.h>
 #include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
 #include "allocator.h"
+#include "tcache.h"
+#include "bench.h"
 
 Allocator* allocator_create(void* memory, size_t size) {
     return (Allocator*)1; // Заглушка
@@ -23,18 +29,51 @@ AllocatorStats allocator_get_stats(Allocator* allocator) {
     return (AllocatorStats){0, 0}; // Не поддерживается для fallback
 }
 
+void* allocator_realloc(Allocator* allocator, void* ptr, size_t size) {
+    return realloc(ptr, size);
+}
+
+void* allocator_aligned_alloc(Allocator* allocator, size_t alignment, size_t size) {
+    return aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+}
+
 // Загрузка аллокатора из библиотеки
 typedef Allocator* (*CreateFunc)(void*, size_t);
 typedef void (*DestroyFunc)(Allocator*);
 typedef void* (*AllocFunc)(Allocator*, size_t);
 typedef void (*FreeFunc)(Allocator*, void*);
 typedef AllocatorStats (*StatsFunc)(Allocator*);
+typedef size_t (*AllocBatchFunc)(Allocator*, size_t, void**, size_t);
+typedef void (*FreeBatchFunc)(Allocator*, void**, size_t);
+typedef void* (*ReallocFunc)(Allocator*, void*, size_t);
+typedef void* (*AlignedAllocFunc)(Allocator*, size_t, size_t);
+typedef void (*InfoFunc)(Allocator*, AllocatorInfo*);
+typedef void (*WalkFunc)(Allocator*, AllocatorWalkFunc, void*);
 
 CreateFunc create_allocator = NULL;
 DestroyFunc destroy_allocator = NULL;
 AllocFunc alloc = NULL;
 FreeFunc free_ptr = NULL;
 StatsFunc get_stats = NULL;
+AllocBatchFunc alloc_batch = NULL;
+FreeBatchFunc free_batch = NULL;
+int native_batch = 0;       // Библиотека экспортирует пакетные функции
+ReallocFunc realloc_ptr = NULL;             // NULL, если не экспортируется
+AlignedAllocFunc aligned_alloc_ptr = NULL;
+InfoFunc get_info = NULL;                   // Интроспекция, NULL у malloc
+WalkFunc walk_heap = NULL;
+int thread_safe = 0;        // Библиотека сама синхронизирует потоки
+
+// Замена пакетных функций для библиотек, которые их не экспортируют
+size_t loop_alloc_batch(Allocator* allocator, size_t size, void** out, size_t n) {
+    size_t done = 0;
+    while (done < n && (out[done] = alloc(allocator, size)) != NULL) done++;
+    return done;
+}
+
+void loop_free_batch(Allocator* allocator, void** ptrs, size_t n) {
+    for (size_t i = 0; i < n; i++) free_ptr(allocator, ptrs[i]);
+}
 
 void load_default_allocators() {
     create_allocator = allocator_create;
@@ -42,62 +81,621 @@ void load_default_allocators() {
     alloc = allocator_alloc;
     free_ptr = allocator_free;
     get_stats = allocator_get_stats;
+    alloc_batch = loop_alloc_batch;
+    free_batch = loop_free_batch;
+    native_batch = 0;
+    realloc_ptr = allocator_realloc;
+    aligned_alloc_ptr = allocator_aligned_alloc;
+    get_info = NULL;
+    walk_heap = NULL;
+    thread_safe = 1;        // malloc потокобезопасен
 }
 
-void test_performance(Allocator* allocator) {
+void* load_allocator(const char* path) {
+    void* lib_handle = dlopen(path, RTLD_LAZY);
+    if (!lib_handle) {
+        fprintf(stderr, "%s\n", dlerror());
+        return NULL;
+    }
+    create_allocator = (CreateFunc)dlsym(lib_handle, "allocator_create");
+    destroy_allocator = (DestroyFunc)dlsym(lib_handle, "allocator_destroy");
+    alloc = (AllocFunc)dlsym(lib_handle, "allocator_alloc");
+    free_ptr = (FreeFunc)dlsym(lib_handle, "allocator_free");
+    get_stats = (StatsFunc)dlsym(lib_handle, "allocator_get_stats");
+    if (!create_allocator || !destroy_allocator || !alloc || !free_ptr || !get_stats) {
+        fprintf(stderr, "%s: missing allocator symbols\n", path);
+        dlclose(lib_handle);
+        return NULL;
+    }
+    alloc_batch = (AllocBatchFunc)dlsym(lib_handle, "allocator_alloc_batch");
+    free_batch = (FreeBatchFunc)dlsym(lib_handle, "allocator_free_batch");
+    native_batch = alloc_batch && free_batch;
+    if (!native_batch) {
+        alloc_batch = loop_alloc_batch;
+        free_batch = loop_free_batch;
+    }
+    realloc_ptr = (ReallocFunc)dlsym(lib_handle, "allocator_realloc");
+    aligned_alloc_ptr = (AlignedAllocFunc)dlsym(lib_handle, "allocator_aligned_alloc");
+    get_info = (InfoFunc)dlsym(lib_handle, "allocator_get_info");
+    walk_heap = (WalkFunc)dlsym(lib_handle, "allocator_walk");
+    const int* safe = dlsym(lib_handle, "allocator_thread_safe");
+    thread_safe = safe && *safe;
+    return lib_handle;
+}
+
+// Те же 100000 блоков по 32 байта, но пакетами
+void test_batch(Allocator* allocator) {
     const int NUM_OPS = 100000;
-    void* blocks[NUM_OPS];
+    const int BATCH = 64;
+    void** blocks = malloc(NUM_OPS * sizeof(void*));
     struct timespec start, end;
+    int done = 0;
 
     clock_gettime(CLOCK_MONOTONIC, &start);
-    for (int i = 0; i < NUM_OPS; i++) {
-        blocks[i] = alloc(allocator, 32);
+    while (done < NUM_OPS) {
+        size_t n = NUM_OPS - done < BATCH ? NUM_OPS - done : BATCH;
+        size_t got = alloc_batch(allocator, 32, blocks + done, n);
+        done += got;
+        if (got < n) break;
     }
     clock_gettime(CLOCK_MONOTONIC, &end);
     double alloc_time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 
-    // Расчет фактора использования
-    AllocatorStats stats = get_stats(allocator);
-    double utilization = (stats.requested * 100.0) / stats.allocated;
-
     clock_gettime(CLOCK_MONOTONIC, &start);
-    for (int i = 0; i < NUM_OPS; i++) {
-        free_ptr(allocator, blocks[i]);
+    for (int i = 0; i < done; i += BATCH) {
+        free_batch(allocator, blocks + i, done - i < BATCH ? done - i : BATCH);
     }
     clock_gettime(CLOCK_MONOTONIC, &end);
     double free_time = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 
-    printf("Allocation time: %.6f sec\n", alloc_time);
-    printf("Free time: %.6f sec\n", free_time);
-    printf("Memory utilization: %.2f%%\n", utilization);
+    printf("Batch alloc time (%s): %.6f sec\n", native_batch ? "native" : "loop", alloc_time);
+    printf("Batch free time (%s): %.6f sec\n", native_batch ? "native" : "loop", free_time);
+    free(blocks);
 }
 
-int main(int argc, char** argv) {
-    void* lib_handle = NULL;
-    if (argc > 1) {
-        lib_handle = dlopen(argv[1], RTLD_LAZY);
-        if (lib_handle) {
-            create_allocator = (CreateFunc)dlsym(lib_handle, "allocator_create");
-            destroy_allocator = (DestroyFunc)dlsym(lib_handle, "allocator_destroy");
-            alloc = (AllocFunc)dlsym(lib_handle, "allocator_alloc");
-            free_ptr = (FreeFunc)dlsym(lib_handle, "allocator_free");
-            get_stats = (StatsFunc)dlsym(lib_handle, "allocator_get_stats");
-            if (!create_allocator || !destroy_allocator || !alloc || !free_ptr || !get_stats) {
-                dlclose(lib_handle);
-                lib_handle = NULL;
+// Рост буферов по кругу: realloc против alloc + memcpy + free
+void test_realloc(void) {
+    const int BUFFERS = 64;
+    const size_t MAX_SIZE = 32 * 1024;
+    size_t size = 1 << 24;
+    void* buffers[BUFFERS];
+    struct timespec start, end;
+
+    if (!realloc_ptr) {
+        printf("Realloc: not supported\n");
+        return;
+    }
+
+    for (int mode = 0; mode < 2; mode++) {
+        void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        Allocator* allocator = create_allocator(memory, size);
+        long in_place = 0, moved = 0;
+
+        for (int i = 0; i < BUFFERS; i++) buffers[i] = alloc(allocator, 64);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (size_t cur = 64; cur < MAX_SIZE; cur += cur / 4) {
+            size_t next = cur + cur / 4;
+            for (int i = 0; i < BUFFERS; i++) {
+                if (!buffers[i]) continue;
+                void* grown;
+                if (mode == 0) {
+                    grown = realloc_ptr(allocator, buffers[i], next);
+                } else {
+                    grown = alloc(allocator, next);
+                    if (grown) {
+                        memcpy(grown, buffers[i], cur);
+                        free_ptr(allocator, buffers[i]);
+                    }
+                }
+                if (!grown) continue;
+                if (grown == buffers[i]) in_place++; else moved++;
+                buffers[i] = grown;
             }
         }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+        printf("%s: %.6f sec, in place %ld, moved %ld\n",
+               mode == 0 ? "Realloc growth" : "Alloc+copy growth", elapsed, in_place, moved);
+        for (int i = 0; i < BUFFERS; i++) free_ptr(allocator, buffers[i]);
+        destroy_allocator(allocator);
+        munmap(memory, size);
+    }
+}
+
+// Выровненные блоки: строка кэша и страница
+void test_aligned(void) {
+    const size_t alignments[] = {64, 4096};
+    const int COUNT = 500;
+    size_t size = 1 << 24;
+    void* blocks[COUNT];
+
+    if (!aligned_alloc_ptr) {
+        printf("Aligned alloc: not supported\n");
+        return;
+    }
+
+    for (size_t a = 0; a < sizeof(alignments) / sizeof(alignments[0]); a++) {
+        void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        Allocator* allocator = create_allocator(memory, size);
+        int misaligned = 0, failed = 0;
+
+        for (int i = 0; i < COUNT; i++) {
+            blocks[i] = aligned_alloc_ptr(allocator, alignments[a], 200 + i % 800);
+            if (!blocks[i]) failed++;
+            else if ((size_t)blocks[i] % alignments[a]) misaligned++;
+        }
+        AllocatorStats stats = get_stats(allocator);
+        double utilization = stats.allocated ? (stats.requested * 100.0) / stats.allocated : 0.0;
+        printf("Aligned %zu: %d misaligned, %d failed, utilization %.2f%%\n",
+               alignments[a], misaligned, failed, utilization);
+
+        for (int i = 0; i < COUNT; i++) free_ptr(allocator, blocks[i]);
+        destroy_allocator(allocator);
+        munmap(memory, size);
+    }
+}
+
+// Сводка кучи после случайной нагрузки, где половина блоков освобождена
+// вразброс. Обход кучи должен сойтись со счётчиками сводки
+typedef struct {
+    size_t used_blocks, free_blocks, free_bytes;
+} WalkTotals;
+
+static int count_block(void* ptr, size_t size, int used, void* arg) {
+    WalkTotals* totals = arg;
+    if (used) {
+        totals->used_blocks++;
+    } else {
+        totals->free_blocks++;
+        totals->free_bytes += size;
+    }
+    return 0;
+}
+
+void test_info(void) {
+    const int COUNT = 20000;
+    const int POLLS = 1000;
+    size_t size = 1 << 24;
+
+    if (!get_info || !walk_heap) {
+        printf("Introspection: not supported\n");
+        return;
     }
-    if (!lib_handle) load_default_allocators();
 
-    size_t size = 1 << 24; // 16 MB 
     void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
     Allocator* allocator = create_allocator(memory, size);
+    void** blocks = malloc(COUNT * sizeof(void*));
+    AllocatorInfo* info = malloc(sizeof(AllocatorInfo));
+    struct timespec start, end;
+
+    srand(7);
+    for (int i = 0; i < COUNT; i++) blocks[i] = alloc(allocator, 16 + rand() % 1009);
+    for (int i = 0; i < COUNT; i++) {
+        if (rand() % 2) {
+            free_ptr(allocator, blocks[i]);
+            blocks[i] = NULL;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < POLLS; i++) get_info(allocator, info);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double poll_ns = ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / POLLS;
+
+    WalkTotals totals = {0, 0, 0};
+    walk_heap(allocator, count_block, &totals);
+    int consistent = totals.used_blocks == info->live_blocks &&
+                     totals.free_blocks == info->free_blocks &&
+                     totals.free_bytes == info->free_bytes;
+
+    printf("Live: %zu blocks, requested %zu, allocated %zu (peak %zu / %zu)\n",
+           info->live_blocks, info->live_requested, info->live_allocated,
+           info->peak_requested, info->peak_allocated);
+    printf("Free: %zu blocks, %zu bytes, largest %zu, external fragmentation %.1f%%\n",
+           info->free_blocks, info->free_bytes, info->largest_free,
+           info->external_fragmentation * 100);
+    printf("Free by class:");
+    for (size_t i = 0; i < info->num_classes; i++) {
+        if (info->classes[i].free_blocks) {
+            printf(" %zu:%zu", info->classes[i].block_size, info->classes[i].free_blocks);
+        }
+    }
+    printf("\nHeap walk %s, get_info %.0f ns\n",
+           consistent ? "matches summary" : "MISMATCH with summary", poll_ns);
+
+    for (int i = 0; i < COUNT; i++) free_ptr(allocator, blocks[i]);
+    get_info(allocator, info);
+    if (info->live_requested || info->live_allocated || info->live_blocks) {
+        printf("Leak after freeing everything: %zu requested, %zu allocated, %zu blocks\n",
+               info->live_requested, info->live_allocated, info->live_blocks);
+    }
+
+    free(info);
+    free(blocks);
+    destroy_allocator(allocator);
+    munmap(memory, size);
+}
+
+// Стоимость alloc/free при разном числе живых блоков: в установившемся
+// режиме освобождаем случайный блок и сразу выделяем новый случайного размера
+void test_scaling(void) {
+    const size_t live_counts[] = {1000, 10000, 100000, 1000000};
+    const int NUM_OPS = 20000;
+
+    printf("Live blocks | alloc ns/op | free ns/op\n");
+    for (size_t t = 0; t < sizeof(live_counts) / sizeof(live_counts[0]); t++) {
+        size_t live = live_counts[t];
+        size_t size = live * 512; // С запасом под заголовки и округление
+        if (size < (1 << 24)) size = 1 << 24;
+
+        void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        void** blocks = malloc(live * sizeof(void*));
+        if (memory == MAP_FAILED || !blocks) {
+            fprintf(stderr, "Not enough memory for %zu live blocks\n", live);
+            if (memory != MAP_FAILED) munmap(memory, size);
+            free(blocks);
+            return;
+        }
+
+        Allocator* allocator = create_allocator(memory, size);
+        srand(42);
+        size_t filled = 0;
+        while (filled < live) {
+            blocks[filled] = alloc(allocator, 16 + rand() % 113);
+            if (!blocks[filled]) break;
+            filled++;
+        }
+
+        if (filled < live) {
+            printf("%11zu | out of memory after %zu blocks\n", live, filled);
+        } else {
+            struct timespec start, end;
+            double alloc_time = 0, free_time = 0;
+            for (int i = 0; i < NUM_OPS; i++) {
+                size_t idx = ((size_t)rand() * RAND_MAX + rand()) % live;
+                size_t new_size = 16 + rand() % 113;
+
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                free_ptr(allocator, blocks[idx]);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                free_time += (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                blocks[idx] = alloc(allocator, new_size);
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                alloc_time += (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+
+                if (!blocks[idx]) {
+                    printf("%11zu | out of memory during churn\n", live);
+                    break;
+                }
+            }
+            printf("%11zu | %11.1f | %10.1f\n", live, alloc_time / NUM_OPS, free_time / NUM_OPS);
+        }
+
+        for (size_t i = 0; i < filled; i++) {
+            free_ptr(allocator, blocks[i]);
+        }
+        destroy_allocator(allocator);
+        free(blocks);
+        munmap(memory, size);
+    }
+}
+
+// Многопоточный тест: бэкенд за глобальным мьютексом против потокового кэша
+#define THREAD_OPS 200000
+#define THREAD_SLOTS 64
+#define SHARED_SLOTS 256
+
+static pthread_mutex_t backend_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic(void*) shared_slots[SHARED_SLOTS];
+
+typedef struct {
+    Allocator* allocator;
+    TCache* tcache;         // NULL - обращаться к бэкенду под мьютексом
+    unsigned seed;
+} ThreadArgs;
+
+static void* locked_alloc(Allocator* allocator, size_t size) {
+    if (thread_safe) return alloc(allocator, size);
+    pthread_mutex_lock(&backend_lock);
+    void* ptr = alloc(allocator, size);
+    pthread_mutex_unlock(&backend_lock);
+    return ptr;
+}
+
+static void locked_free(Allocator* allocator, void* ptr) {
+    if (thread_safe) {
+        free_ptr(allocator, ptr);
+        return;
+    }
+    pthread_mutex_lock(&backend_lock);
+    free_ptr(allocator, ptr);
+    pthread_mutex_unlock(&backend_lock);
+}
 
-    test_performance(allocator);
+static void* thread_alloc(ThreadArgs* args, size_t size) {
+    if (args->tcache) return tcache_alloc(args->tcache, size);
+    return locked_alloc(args->allocator, size);
+}
+
+static void thread_free(ThreadArgs* args, void* ptr) {
+    if (args->tcache) {
+        tcache_free(args->tcache, ptr);
+        return;
+    }
+    locked_free(args->allocator, ptr);
+}
+
+// Каждая восьмая операция обменивает блок через общий массив, так что
+// часть блоков освобождается не тем потоком, который их выделил
+static void* thread_worker(void* arg) {
+    ThreadArgs* args = arg;
+    void* slots[THREAD_SLOTS] = {0};
+    unsigned seed = args->seed;
 
+    for (int i = 0; i < THREAD_OPS; i++) {
+        int idx = rand_r(&seed) % THREAD_SLOTS;
+        if (slots[idx]) {
+            if (i % 8 == 0) {
+                slots[idx] = atomic_exchange(&shared_slots[rand_r(&seed) % SHARED_SLOTS], slots[idx]);
+            }
+            if (slots[idx]) {
+                thread_free(args, slots[idx]);
+                slots[idx] = NULL;
+            }
+        } else {
+            slots[idx] = thread_alloc(args, 16 + rand_r(&seed) % 241);
+        }
+    }
+
+    for (int i = 0; i < THREAD_SLOTS; i++) {
+        if (slots[i]) thread_free(args, slots[i]);
+    }
+    return NULL;
+}
+
+static double run_threads(Allocator* allocator, TCache* tcache, int num_threads) {
+    pthread_t threads[num_threads];
+    ThreadArgs args[num_threads];
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < num_threads; i++) {
+        args[i] = (ThreadArgs){allocator, tcache, (unsigned)i * 7919 + 1};
+        pthread_create(&threads[i], NULL, thread_worker, &args[i]);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    ThreadArgs cleanup = {allocator, tcache, 0};
+    for (int i = 0; i < SHARED_SLOTS; i++) {
+        void* ptr = atomic_exchange(&shared_slots[i], NULL);
+        if (ptr) thread_free(&cleanup, ptr);
+    }
+
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    return (double)num_threads * THREAD_OPS / elapsed;
+}
+
+void test_threads(int max_threads) {
+    size_t size = 1 << 24;
+    printf("Threads | %s ops/sec | tcache ops/sec\n", thread_safe ? "direct" : " mutex");
+    for (int n = 1; n <= max_threads; n = (n * 2 > max_threads && n < max_threads) ? max_threads : n * 2) {
+        void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        Allocator* allocator = create_allocator(memory, size);
+        double locked = run_threads(allocator, NULL, n);
+        destroy_allocator(allocator);
+
+        allocator = create_allocator(memory, size);
+        TCache* tcache = tcache_create(allocator, alloc, free_ptr, thread_safe);
+        double cached = run_threads(allocator, tcache, n);
+        tcache_destroy(tcache);
+        destroy_allocator(allocator);
+        munmap(memory, size);
+
+        printf("%7d | %13.0f | %14.0f\n", n, locked, cached);
+    }
+}
+
+// Стресс-тест: параллельные alloc/free из многих потоков. Каждый выданный
+// блок отмечается в карте владения по 16 байт арены; повторная выдача уже
+// занятой памяти или порча содержимого считаются ошибкой
+#define STRESS_THREADS 16
+#define STRESS_OPS 50000
+#define STRESS_SLOTS 128
+#define GRANULE 16
+
+static char* stress_memory;
+static size_t stress_size;
+static atomic_uchar* stress_owners;
+static atomic_long stress_errors;
+
+typedef struct {
+    Allocator* allocator;
+    unsigned char id;
+} StressArgs;
+
+static void claim_range(void* ptr, size_t size, unsigned char owner) {
+    if ((char*)ptr < stress_memory || (char*)ptr >= stress_memory + stress_size) return;
+    size_t first = ((char*)ptr - stress_memory) / GRANULE;
+    size_t last = ((char*)ptr - stress_memory + size - 1) / GRANULE;
+    for (size_t g = first; g <= last; g++) {
+        if (atomic_exchange(&stress_owners[g], owner) != 0) {
+            atomic_fetch_add(&stress_errors, 1);
+            return;
+        }
+    }
+}
+
+static void release_range(void* ptr, size_t size) {
+    if ((char*)ptr < stress_memory || (char*)ptr >= stress_memory + stress_size) return;
+    size_t first = ((char*)ptr - stress_memory) / GRANULE;
+    size_t last = ((char*)ptr - stress_memory + size - 1) / GRANULE;
+    for (size_t g = first; g <= last; g++) {
+        atomic_store(&stress_owners[g], 0);
+    }
+}
+
+static void* stress_worker(void* arg) {
+    StressArgs* args = arg;
+    void* slots[STRESS_SLOTS] = {0};
+    size_t sizes[STRESS_SLOTS];
+    unsigned seed = args->id * 2654435761u;
+
+    for (int i = 0; i < STRESS_OPS; i++) {
+        int idx = rand_r(&seed) % STRESS_SLOTS;
+        unsigned char* block = slots[idx];
+        if (block) {
+            for (size_t k = 0; k < sizes[idx]; k++) {
+                if (block[k] != args->id) {
+                    atomic_fetch_add(&stress_errors, 1);
+                    break;
+                }
+            }
+            release_range(block, sizes[idx]);
+            locked_free(args->allocator, block);
+            slots[idx] = NULL;
+        } else {
+            size_t size = (rand_r(&seed) % 8 == 0) ? 1 + rand_r(&seed) % 4096 : 1 + rand_r(&seed) % 128;
+            block = locked_alloc(args->allocator, size);
+            if (!block) continue;
+            claim_range(block, size, args->id);
+            memset(block, args->id, size);
+            slots[idx] = block;
+            sizes[idx] = size;
+        }
+    }
+
+    for (int i = 0; i < STRESS_SLOTS; i++) {
+        if (slots[i]) {
+            release_range(slots[i], sizes[i]);
+            locked_free(args->allocator, slots[i]);
+        }
+    }
+    return NULL;
+}
+
+void test_stress(void) {
+    stress_size = 1 << 24;
+    stress_memory = mmap(NULL, stress_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    stress_owners = calloc(stress_size / GRANULE, sizeof(atomic_uchar));
+    atomic_store(&stress_errors, 0);
+    Allocator* allocator = create_allocator(stress_memory, stress_size);
+
+    pthread_t threads[STRESS_THREADS];
+    StressArgs args[STRESS_THREADS];
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < STRESS_THREADS; i++) {
+        args[i] = (StressArgs){allocator, (unsigned char)(i + 1)};
+        pthread_create(&threads[i], NULL, stress_worker, &args[i]);
+    }
+    for (int i = 0; i < STRESS_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("Stress (%d threads, %s): %.0f ops/sec, %s\n", STRESS_THREADS,
+           thread_safe ? "lock-free" : "global mutex",
+           STRESS_THREADS * (double)STRESS_OPS / elapsed,
+           atomic_load(&stress_errors) ? "FAILED: block handed out twice or corrupted" : "no overlaps");
+
+    destroy_allocator(allocator);
+    free(stress_owners);
+    munmap(stress_memory, stress_size);
+}
+
+static void run_tests(int max_threads) {
+    size_t size = 1 << 24; // 16 MB 
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    Allocator* allocator = create_allocator(memory, size);
+
+    test_batch(allocator);
     destroy_allocator(allocator);
     munmap(memory, size);
-    if (lib_handle) dlclose(lib_handle);
+
+    test_realloc();
+    test_aligned();
+    test_info();
+    test_scaling();
+    test_threads(max_threads);
+    test_stress();
+}
+
+static void run_allocator(const char* name, const BenchConfig* config) {
+    BenchAllocator lib = {
+        name, create_allocator, destroy_allocator, alloc, free_ptr, get_stats, realloc_ptr, thread_safe
+    };
+    if (config->format == FORMAT_TEXT) printf("=== %s\n", name);
+    bench_run(&lib, config);
+    // Подробные тесты печатают свободный текст, в CSV/JSON их не смешиваем
+    if (config->format == FORMAT_TEXT) run_tests(config->threads);
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-t threads] [-f text|csv|json] [-n ops] [-l live]\n"
+                    "          [-d uniform|loguniform|fixed] [-s min:max] [-r seed] [allocator.so ...]\n", prog);
+}
+
+// Без библиотек тестируется malloc. В форматах csv/json печатается только
+// таблица бенчмарков, в text - ещё и подробные тесты
+int main(int argc, char** argv) {
+    BenchConfig config;
+    bench_default_config(&config);
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    config.threads = cpus > 0 ? (int)cpus : 4;
+    int libraries = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:f:n:l:d:s:r:")) != -1) {
+        int bad = 0, parsed;
+        switch (opt) {
+        case 't':
+            config.threads = atoi(optarg);
+            if (config.threads < 1) config.threads = 1;
+            break;
+        case 'f':
+            parsed = bench_parse_format(optarg);
+            if (parsed < 0) bad = 1; else config.format = parsed;
+            break;
+        case 'n': config.ops = strtoull(optarg, NULL, 10); break;
+        case 'l': config.live = strtoull(optarg, NULL, 10); break;
+        case 'd':
+            parsed = bench_parse_distribution(optarg);
+            if (parsed < 0) bad = 1; else config.dist = parsed;
+            break;
+        case 's':
+            bad = sscanf(optarg, "%zu:%zu", &config.min_size, &config.max_size) != 2;
+            break;
+        case 'r': config.seed = (unsigned)strtoul(optarg, NULL, 10); break;
+        default: bad = 1; break;
+        }
+        if (bad || config.live == 0 || config.min_size == 0 || config.min_size > config.max_size) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    bench_begin(&config);
+    for (int i = optind; i < argc; i++) {
+        void* lib_handle = load_allocator(argv[i]);
+        if (!lib_handle) continue;
+        run_allocator(argv[i], &config);
+        dlclose(lib_handle);
+        libraries++;
+    }
+
+    if (!libraries) {
+        load_default_allocators();
+        run_allocator("malloc", &config);
+    }
+    bench_end(&config);
     return 0;
-}
\ No newline at end of file
+}
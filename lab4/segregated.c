@@ -0,0 +1,285 @@
+#include "allocator.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// Сегрегированные списки свободных блоков с best-fit поиском.
+// Мелкие блоки (< 1 КБ) лежат в точных классах по 16 байт, крупные -
+// в классах-степенях двойки, отсортированных по размеру. Битовая карта
+// непустых классов позволяет найти подходящий класс за O(1).
+
+#define ALIGNMENT 16
+#define FREE_BIT 1u
+#define PREV_FREE_BIT 2u
+#define FLAGS_MASK ((size_t)ALIGNMENT - 1)
+
+#define SMALL_CLASSES 64                    // классы размеров 0..1008 с шагом 16
+#define LARGE_SHIFT 10                      // крупные блоки начинаются с 1024 байт
+#define NUM_CLASSES 128
+#define BITMAP_WORDS (NUM_CLASSES / 64)
+
+typedef struct SegBlock {
+    size_t size;               // полный размер блока с заголовком | флаги
+    size_t requested;          // запрошенный размер (только у занятого блока)
+    struct SegBlock* next;     // поля списка есть только у свободного блока
+    struct SegBlock* prev;
+} SegBlock;
+
+#define HEADER_SIZE (offsetof(SegBlock, next))
+// Свободный блок: заголовок + указатели списка + футер с размером
+#define MIN_BLOCK ((sizeof(SegBlock) + sizeof(size_t) + FLAGS_MASK) & ~FLAGS_MASK)
+
+typedef struct {
+    void* memory;
+    size_t total_size;
+    SegBlock* bins[NUM_CLASSES];
+    SegBlock* tails[NUM_CLASSES];      // Последний, то есть наибольший, блок класса
+    size_t free_count[NUM_CLASSES];
+    uint64_t bitmap[BITMAP_WORDS];
+    size_t free_bytes;
+    size_t total_requested;
+    size_t total_allocated;
+    size_t live_blocks;
+    size_t peak_requested;
+    size_t peak_allocated;
+} SegregatedAllocator;
+
+static inline size_t block_size(const SegBlock* block) {
+    return block->size & ~FLAGS_MASK;
+}
+
+static inline SegBlock* next_block(SegBlock* block) {
+    return (SegBlock*)((char*)block + block_size(block));
+}
+
+static inline void set_footer(SegBlock* block) {
+    size_t size = block_size(block);
+    *(size_t*)((char*)block + size - sizeof(size_t)) = size;
+}
+
+static size_t size_class(size_t size) {
+    if (size < ((size_t)1 << LARGE_SHIFT)) {
+        return size / ALIGNMENT;
+    }
+    size_t order = 63 - __builtin_clzl(size);
+    size_t cls = SMALL_CLASSES + (order - LARGE_SHIFT);
+    return cls < NUM_CLASSES ? cls : NUM_CLASSES - 1;
+}
+
+// Первый непустой класс, начиная с from, или -1
+static int find_class(const SegregatedAllocator* alloc, size_t from) {
+    if (from >= NUM_CLASSES) return -1;
+    size_t word = from / 64;
+    uint64_t bits = alloc->bitmap[word] & (~0ull << (from % 64));
+    while (!bits) {
+        if (++word >= BITMAP_WORDS) return -1;
+        bits = alloc->bitmap[word];
+    }
+    return (int)(word * 64 + __builtin_ctzll(bits));
+}
+
+static void insert_block(SegregatedAllocator* alloc, SegBlock* block) {
+    size_t size = block_size(block);
+    size_t cls = size_class(size);
+    SegBlock** link = &alloc->bins[cls];
+    SegBlock* prev = NULL;
+
+    // Крупные классы держим отсортированными, чтобы первый подходящий
+    // блок был наилучшим
+    if (cls >= SMALL_CLASSES) {
+        while (*link && block_size(*link) < size) {
+            prev = *link;
+            link = &(*link)->next;
+        }
+    }
+
+    block->next = *link;
+    block->prev = prev;
+    if (*link) (*link)->prev = block;
+    else alloc->tails[cls] = block;
+    *link = block;
+    alloc->bitmap[cls / 64] |= 1ull << (cls % 64);
+    alloc->free_count[cls]++;
+    alloc->free_bytes += size;
+}
+
+static void remove_block(SegregatedAllocator* alloc, SegBlock* block) {
+    size_t cls = size_class(block_size(block));
+    if (block->prev) {
+        block->prev->next = block->next;
+    } else {
+        alloc->bins[cls] = block->next;
+    }
+    if (block->next) block->next->prev = block->prev;
+    else alloc->tails[cls] = block->prev;
+    if (!alloc->bins[cls]) {
+        alloc->bitmap[cls / 64] &= ~(1ull << (cls % 64));
+    }
+    alloc->free_count[cls]--;
+    alloc->free_bytes -= block_size(block);
+}
+
+static SegBlock* find_best(SegregatedAllocator* alloc, size_t size) {
+    size_t cls = size_class(size);
+
+    if (cls >= SMALL_CLASSES) {
+        for (SegBlock* block = alloc->bins[cls]; block; block = block->next) {
+            if (block_size(block) >= size) return block;
+        }
+        cls++;
+    }
+
+    // Все блоки в классах выше запрошенного заведомо подходят
+    int found = find_class(alloc, cls);
+    return found < 0 ? NULL : alloc->bins[found];
+}
+
+Allocator* allocator_create(void* memory, size_t size) {
+    uintptr_t start = ((uintptr_t)memory + FLAGS_MASK) & ~(uintptr_t)FLAGS_MASK;
+    uintptr_t end = ((uintptr_t)memory + size) & ~(uintptr_t)FLAGS_MASK;
+    if (end <= start || end - start < MIN_BLOCK + HEADER_SIZE) {
+        fprintf(stderr, "Memory size too small\n");
+        return NULL;
+    }
+
+    SegregatedAllocator* alloc = malloc(sizeof(SegregatedAllocator));
+    if (!alloc) return NULL;
+    memset(alloc, 0, sizeof(SegregatedAllocator));
+
+    alloc->memory = (void*)start;
+    alloc->total_size = end - start;
+
+    // В конце арены - занятый блок нулевого размера, чтобы слияние
+    // с соседом справа не выходило за границу
+    SegBlock* initial = (SegBlock*)start;
+    initial->size = (alloc->total_size - HEADER_SIZE) | FREE_BIT;
+    set_footer(initial);
+    SegBlock* epilogue = next_block(initial);
+    epilogue->size = PREV_FREE_BIT;
+    epilogue->requested = 0;
+
+    insert_block(alloc, initial);
+    return (Allocator*)alloc;
+}
+
+void allocator_destroy(Allocator* allocator) {
+    free((SegregatedAllocator*)allocator);
+}
+
+void* allocator_alloc(Allocator* allocator, size_t size) {
+    SegregatedAllocator* alloc = (SegregatedAllocator*)allocator;
+    if (size == 0 || size > alloc->total_size) return NULL;
+
+    size_t required = (size + HEADER_SIZE + FLAGS_MASK) & ~FLAGS_MASK;
+    if (required < MIN_BLOCK) required = MIN_BLOCK;
+
+    SegBlock* best = find_best(alloc, required);
+    if (!best) return NULL;
+    remove_block(alloc, best);
+
+    // Разделяем блок, если остаток может быть самостоятельным блоком
+    size_t available = block_size(best);
+    if (available - required >= MIN_BLOCK) {
+        SegBlock* rest = (SegBlock*)((char*)best + required);
+        rest->size = (available - required) | FREE_BIT;
+        set_footer(rest);
+        insert_block(alloc, rest);
+        available = required;
+    } else {
+        next_block(best)->size &= ~(size_t)PREV_FREE_BIT;
+    }
+
+    best->size = available | (best->size & PREV_FREE_BIT);
+    best->requested = size;
+    alloc->total_requested += size;
+    alloc->total_allocated += available;
+    alloc->live_blocks++;
+    if (alloc->total_requested > alloc->peak_requested) alloc->peak_requested = alloc->total_requested;
+    if (alloc->total_allocated > alloc->peak_allocated) alloc->peak_allocated = alloc->total_allocated;
+
+    return (char*)best + HEADER_SIZE;
+}
+
+void allocator_free(Allocator* allocator, void* ptr) {
+    SegregatedAllocator* alloc = (SegregatedAllocator*)allocator;
+    if (!ptr) return;
+
+    SegBlock* block = (SegBlock*)((char*)ptr - HEADER_SIZE);
+    if ((char*)block < (char*)alloc->memory ||
+        (char*)block >= (char*)alloc->memory + alloc->total_size ||
+        (block->size & FREE_BIT)) {
+        return;
+    }
+
+    size_t size = block_size(block);
+    alloc->total_requested -= block->requested;
+    alloc->total_allocated -= size;
+    alloc->live_blocks--;
+
+    SegBlock* next = next_block(block);
+    if (next->size & FREE_BIT) {
+        remove_block(alloc, next);
+        size += block_size(next);
+    }
+
+    if (block->size & PREV_FREE_BIT) {
+        size_t prev_size = *(size_t*)((char*)block - sizeof(size_t));
+        SegBlock* prev = (SegBlock*)((char*)block - prev_size);
+        remove_block(alloc, prev);
+        size += prev_size;
+        block = prev;
+    }
+
+    // Слева от свободного блока всегда занятый блок - иначе они бы слились
+    block->size = size | FREE_BIT;
+    set_footer(block);
+    next_block(block)->size |= PREV_FREE_BIT;
+    insert_block(alloc, block);
+}
+
+AllocatorStats allocator_get_stats(Allocator* allocator) {
+    SegregatedAllocator* alloc = (SegregatedAllocator*)allocator;
+    return (AllocatorStats){
+        .requested = alloc->total_requested,
+        .allocated = alloc->total_allocated
+    };
+}
+
+void allocator_get_info(Allocator* allocator, AllocatorInfo* info) {
+    SegregatedAllocator* alloc = (SegregatedAllocator*)allocator;
+    memset(info, 0, sizeof(AllocatorInfo));
+    info->live_requested = alloc->total_requested;
+    info->live_allocated = alloc->total_allocated;
+    info->live_blocks = alloc->live_blocks;
+    info->peak_requested = alloc->peak_requested;
+    info->peak_allocated = alloc->peak_allocated;
+
+    // Классы меньше MIN_BLOCK и больше 2^63 всегда пусты
+    for (size_t cls = MIN_BLOCK / ALIGNMENT; cls < SMALL_CLASSES + 64 - LARGE_SHIFT; cls++) {
+        size_t lower = cls < SMALL_CLASSES ? cls * ALIGNMENT
+                                           : (size_t)1 << (cls - SMALL_CLASSES + LARGE_SHIFT);
+        AllocatorClassInfo* info_cls = &info->classes[info->num_classes++];
+        info_cls->block_size = lower - HEADER_SIZE;
+        info_cls->free_blocks = alloc->free_count[cls];
+        if (alloc->tails[cls]) info_cls->largest_free = block_size(alloc->tails[cls]) - HEADER_SIZE;
+        info->free_blocks += info_cls->free_blocks;
+        if (info_cls->largest_free > info->largest_free) info->largest_free = info_cls->largest_free;
+    }
+
+    info->free_bytes = alloc->free_bytes - info->free_blocks * HEADER_SIZE;
+    if (info->free_bytes) {
+        info->external_fragmentation = 1.0 - (double)info->largest_free / info->free_bytes;
+    }
+}
+
+void allocator_walk(Allocator* allocator, AllocatorWalkFunc callback, void* arg) {
+    SegregatedAllocator* alloc = (SegregatedAllocator*)allocator;
+    // Обход до эпилога - блока нулевого размера
+    for (SegBlock* block = alloc->memory; block_size(block); block = next_block(block)) {
+        int used = !(block->size & FREE_BIT);
+        if (callback((char*)block + HEADER_SIZE, block_size(block) - HEADER_SIZE, used, arg)) return;
+    }
+}
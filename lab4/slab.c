@@ -0,0 +1,355 @@
+#include "allocator.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// Slab-аллокатор: арена режется на страницы, каждая страница-slab хранит
+// объекты одного класса размеров сплошным массивом. Свободные слоты связаны
+// встроенным списком, новые выдаются "с хвоста", чтобы не трогать всю
+// страницу при создании slab'а. Запросы больше MAX_OBJECT получают целые
+// страницы. Дескрипторы страниц лежат вне арены.
+
+#define PAGE_SIZE 4096
+#define SLOT_ALIGN 16
+#define MAX_OBJECT 2048
+
+enum { PAGE_FREE, PAGE_SLAB, PAGE_RUN, PAGE_RUN_CONT };
+
+static const uint32_t class_sizes[] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256,
+    320, 384, 448, 512, 640, 768, 1024, 1360, 2048
+};
+#define NUM_CLASSES (sizeof(class_sizes) / sizeof(class_sizes[0]))
+
+typedef struct FreeSlot {
+    struct FreeSlot* next;
+} FreeSlot;
+
+typedef struct SlabPage {
+    struct SlabPage* next;     // Список частично занятых slab'ов класса
+    struct SlabPage* prev;     // или список свободных участков страниц
+    FreeSlot* free_slots;
+    uint32_t bump;             // Индекс первого ещё не выданного слота
+    uint32_t used;
+    uint32_t cls;
+    uint32_t kind;
+    size_t pages;              // Длина участка (у первой и последней страницы)
+} SlabPage;
+
+typedef struct {
+    void* memory;
+    size_t total_size;
+    size_t num_pages;
+    SlabPage* pages;
+    SlabPage* partial[NUM_CLASSES];
+    SlabPage* free_spans;
+    uint8_t class_index[MAX_OBJECT / SLOT_ALIGN + 1];
+    uint16_t* slack;           // Размер слота минус запрошенный, по 16 байт арены
+    size_t free_slots[NUM_CLASSES];
+    size_t total_requested;
+    size_t total_allocated;
+    size_t live_blocks;
+    size_t peak_requested;
+    size_t peak_allocated;
+} SlabAllocator;
+
+static inline size_t page_index(SlabAllocator* alloc, SlabPage* page) {
+    return page - alloc->pages;
+}
+
+static inline char* page_memory(SlabAllocator* alloc, SlabPage* page) {
+    return (char*)alloc->memory + page_index(alloc, page) * PAGE_SIZE;
+}
+
+static void list_push(SlabPage** head, SlabPage* page) {
+    page->prev = NULL;
+    page->next = *head;
+    if (*head) (*head)->prev = page;
+    *head = page;
+}
+
+static void list_remove(SlabPage** head, SlabPage* page) {
+    if (page->prev) {
+        page->prev->next = page->next;
+    } else {
+        *head = page->next;
+    }
+    if (page->next) page->next->prev = page->prev;
+    page->next = page->prev = NULL;
+}
+
+// Свободный участок помечается на первой и последней странице,
+// чтобы соседи находили его за O(1)
+static void make_span(SlabAllocator* alloc, size_t first, size_t count) {
+    SlabPage* head = &alloc->pages[first];
+    SlabPage* tail = &alloc->pages[first + count - 1];
+    head->kind = tail->kind = PAGE_FREE;
+    head->pages = tail->pages = count;
+    list_push(&alloc->free_spans, head);
+}
+
+static SlabPage* take_pages(SlabAllocator* alloc, size_t count) {
+    SlabPage* span = alloc->free_spans;
+    while (span && span->pages < count) span = span->next;
+    if (!span) return NULL;
+
+    size_t first = page_index(alloc, span);
+    size_t available = span->pages;
+    list_remove(&alloc->free_spans, span);
+    if (available > count) {
+        make_span(alloc, first + count, available - count);
+    }
+    return span;
+}
+
+static void release_pages(SlabAllocator* alloc, size_t first, size_t count) {
+    if (first > 0 && alloc->pages[first - 1].kind == PAGE_FREE) {
+        size_t prev_count = alloc->pages[first - 1].pages;
+        first -= prev_count;
+        count += prev_count;
+        list_remove(&alloc->free_spans, &alloc->pages[first]);
+    }
+    size_t end = first + count;
+    if (end < alloc->num_pages && alloc->pages[end].kind == PAGE_FREE) {
+        count += alloc->pages[end].pages;
+        list_remove(&alloc->free_spans, &alloc->pages[end]);
+    }
+    make_span(alloc, first, count);
+}
+
+static inline uint32_t slab_capacity(uint32_t cls) {
+    return PAGE_SIZE / class_sizes[cls];
+}
+
+static void set_slack(SlabAllocator* alloc, void* ptr, size_t slack) {
+    alloc->slack[((char*)ptr - (char*)alloc->memory) / SLOT_ALIGN] = (uint16_t)slack;
+}
+
+static size_t get_slack(SlabAllocator* alloc, void* ptr) {
+    return alloc->slack[((char*)ptr - (char*)alloc->memory) / SLOT_ALIGN];
+}
+
+Allocator* allocator_create(void* memory, size_t size) {
+    uintptr_t start = ((uintptr_t)memory + PAGE_SIZE - 1) & ~(uintptr_t)(PAGE_SIZE - 1);
+    uintptr_t end = ((uintptr_t)memory + size) & ~(uintptr_t)(PAGE_SIZE - 1);
+    if (end <= start) {
+        fprintf(stderr, "Memory size too small\n");
+        return NULL;
+    }
+
+    SlabAllocator* alloc = malloc(sizeof(SlabAllocator));
+    if (!alloc) return NULL;
+    memset(alloc, 0, sizeof(SlabAllocator));
+
+    alloc->memory = (void*)start;
+    alloc->total_size = end - start;
+    alloc->num_pages = alloc->total_size / PAGE_SIZE;
+    alloc->pages = calloc(alloc->num_pages, sizeof(SlabPage));
+    alloc->slack = calloc(alloc->total_size / SLOT_ALIGN, sizeof(uint16_t));
+    if (!alloc->pages || !alloc->slack) {
+        free(alloc->pages);
+        free(alloc->slack);
+        free(alloc);
+        return NULL;
+    }
+
+    // Таблица "размер / 16 -> класс" делает поиск класса O(1)
+    size_t cls = 0;
+    for (size_t i = 0; i <= MAX_OBJECT / SLOT_ALIGN; i++) {
+        while (class_sizes[cls] < i * SLOT_ALIGN) cls++;
+        alloc->class_index[i] = (uint8_t)cls;
+    }
+
+    make_span(alloc, 0, alloc->num_pages);
+    return (Allocator*)alloc;
+}
+
+void allocator_destroy(Allocator* allocator) {
+    SlabAllocator* alloc = (SlabAllocator*)allocator;
+    free(alloc->pages);
+    free(alloc->slack);
+    free(alloc);
+}
+
+static void account_alloc(SlabAllocator* alloc, size_t requested, size_t allocated) {
+    alloc->total_requested += requested;
+    alloc->total_allocated += allocated;
+    alloc->live_blocks++;
+    if (alloc->total_requested > alloc->peak_requested) alloc->peak_requested = alloc->total_requested;
+    if (alloc->total_allocated > alloc->peak_allocated) alloc->peak_allocated = alloc->total_allocated;
+}
+
+static void* alloc_pages(SlabAllocator* alloc, size_t size) {
+    size_t count = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    SlabPage* run = take_pages(alloc, count);
+    if (!run) return NULL;
+
+    size_t first = page_index(alloc, run);
+    for (size_t i = 1; i < count; i++) {
+        alloc->pages[first + i].kind = PAGE_RUN_CONT;
+    }
+    run->kind = PAGE_RUN;
+    run->pages = count;
+
+    void* ptr = page_memory(alloc, run);
+    size_t slack = count * PAGE_SIZE - size;
+    set_slack(alloc, ptr, slack);
+    account_alloc(alloc, size, count * PAGE_SIZE);
+    return ptr;
+}
+
+void* allocator_alloc(Allocator* allocator, size_t size) {
+    SlabAllocator* alloc = (SlabAllocator*)allocator;
+    if (size == 0 || size > alloc->total_size) return NULL;
+    if (size > MAX_OBJECT) return alloc_pages(alloc, size);
+
+    uint32_t cls = alloc->class_index[(size + SLOT_ALIGN - 1) / SLOT_ALIGN];
+    SlabPage* slab = alloc->partial[cls];
+    if (!slab) {
+        slab = take_pages(alloc, 1);
+        if (!slab) return NULL;
+        slab->kind = PAGE_SLAB;
+        slab->pages = 1;
+        slab->cls = cls;
+        slab->used = 0;
+        slab->bump = 0;
+        slab->free_slots = NULL;
+        list_push(&alloc->partial[cls], slab);
+        alloc->free_slots[cls] += slab_capacity(cls);
+    }
+
+    void* ptr;
+    if (slab->free_slots) {
+        ptr = slab->free_slots;
+        slab->free_slots = slab->free_slots->next;
+    } else {
+        ptr = page_memory(alloc, slab) + (size_t)slab->bump * class_sizes[cls];
+        slab->bump++;
+    }
+
+    if (++slab->used == slab_capacity(cls)) {
+        list_remove(&alloc->partial[cls], slab);
+    }
+
+    alloc->free_slots[cls]--;
+    set_slack(alloc, ptr, class_sizes[cls] - size);
+    account_alloc(alloc, size, class_sizes[cls]);
+    return ptr;
+}
+
+void allocator_free(Allocator* allocator, void* ptr) {
+    SlabAllocator* alloc = (SlabAllocator*)allocator;
+    if (!ptr) return;
+    if ((char*)ptr < (char*)alloc->memory ||
+        (char*)ptr >= (char*)alloc->memory + alloc->total_size) {
+        return;
+    }
+
+    size_t offset = (char*)ptr - (char*)alloc->memory;
+    SlabPage* page = &alloc->pages[offset / PAGE_SIZE];
+
+    if (page->kind == PAGE_RUN && offset % PAGE_SIZE == 0) {
+        size_t bytes = page->pages * PAGE_SIZE;
+        alloc->total_requested -= bytes - get_slack(alloc, ptr);
+        alloc->total_allocated -= bytes;
+        alloc->live_blocks--;
+        release_pages(alloc, offset / PAGE_SIZE, page->pages);
+        return;
+    }
+    if (page->kind != PAGE_SLAB || (offset % PAGE_SIZE) % class_sizes[page->cls] != 0) {
+        return;
+    }
+
+    uint32_t cls = page->cls;
+    alloc->total_requested -= class_sizes[cls] - get_slack(alloc, ptr);
+    alloc->total_allocated -= class_sizes[cls];
+    alloc->live_blocks--;
+    alloc->free_slots[cls]++;
+
+    if (page->used == slab_capacity(cls)) {
+        list_push(&alloc->partial[cls], page);
+    }
+
+    FreeSlot* slot = ptr;
+    slot->next = page->free_slots;
+    page->free_slots = slot;
+
+    // Пустой slab возвращаем в пул страниц, если у класса есть другие
+    if (--page->used == 0 && (page->prev || page->next)) {
+        list_remove(&alloc->partial[cls], page);
+        alloc->free_slots[cls] -= slab_capacity(cls);
+        release_pages(alloc, offset / PAGE_SIZE, 1);
+    }
+}
+
+AllocatorStats allocator_get_stats(Allocator* allocator) {
+    SlabAllocator* alloc = (SlabAllocator*)allocator;
+    return (AllocatorStats){
+        .requested = alloc->total_requested,
+        .allocated = alloc->total_allocated
+    };
+}
+
+void allocator_get_info(Allocator* allocator, AllocatorInfo* info) {
+    SlabAllocator* alloc = (SlabAllocator*)allocator;
+    memset(info, 0, sizeof(AllocatorInfo));
+    info->live_requested = alloc->total_requested;
+    info->live_allocated = alloc->total_allocated;
+    info->live_blocks = alloc->live_blocks;
+    info->peak_requested = alloc->peak_requested;
+    info->peak_allocated = alloc->peak_allocated;
+
+    for (size_t cls = 0; cls < NUM_CLASSES; cls++) {
+        AllocatorClassInfo* info_cls = &info->classes[info->num_classes++];
+        info_cls->block_size = class_sizes[cls];
+        info_cls->free_blocks = alloc->free_slots[cls];
+        info_cls->largest_free = alloc->free_slots[cls] ? class_sizes[cls] : 0;
+        info->free_blocks += alloc->free_slots[cls];
+        info->free_bytes += alloc->free_slots[cls] * class_sizes[cls];
+        if (info_cls->largest_free > info->largest_free) info->largest_free = info_cls->largest_free;
+    }
+
+    // Последний класс - свободные участки страниц; их список и так
+    // просматривается при каждом выделении slab'а
+    AllocatorClassInfo* spans = &info->classes[info->num_classes++];
+    spans->block_size = PAGE_SIZE;
+    for (SlabPage* span = alloc->free_spans; span; span = span->next) {
+        size_t bytes = span->pages * PAGE_SIZE;
+        spans->free_blocks++;
+        info->free_bytes += bytes;
+        if (bytes > spans->largest_free) spans->largest_free = bytes;
+    }
+    info->free_blocks += spans->free_blocks;
+    if (spans->largest_free > info->largest_free) info->largest_free = spans->largest_free;
+    if (info->free_bytes) {
+        info->external_fragmentation = 1.0 - (double)info->largest_free / info->free_bytes;
+    }
+}
+
+void allocator_walk(Allocator* allocator, AllocatorWalkFunc callback, void* arg) {
+    SlabAllocator* alloc = (SlabAllocator*)allocator;
+    bool free_slot[PAGE_SIZE / SLOT_ALIGN];
+
+    for (size_t i = 0; i < alloc->num_pages; i += alloc->pages[i].pages) {
+        SlabPage* page = &alloc->pages[i];
+        char* memory = page_memory(alloc, page);
+        if (page->kind != PAGE_SLAB) {
+            if (callback(memory, page->pages * PAGE_SIZE, page->kind == PAGE_RUN, arg)) return;
+            continue;
+        }
+
+        // Свободны слоты из встроенного списка и ещё не выданные с хвоста
+        uint32_t size = class_sizes[page->cls];
+        uint32_t capacity = slab_capacity(page->cls);
+        for (uint32_t slot = 0; slot < capacity; slot++) free_slot[slot] = slot >= page->bump;
+        for (FreeSlot* slot = page->free_slots; slot; slot = slot->next) {
+            free_slot[((char*)slot - memory) / size] = true;
+        }
+        for (uint32_t slot = 0; slot < capacity; slot++) {
+            if (callback(memory + (size_t)slot * size, size, !free_slot[slot], arg)) return;
+        }
+    }
+}
@@ -0,0 +1,278 @@
+#include "tcache.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TCACHE_ALIGN 16
+#define TCACHE_MAX_SIZE 512                       // Более крупные блоки идут сразу в бэкенд
+#define NUM_CLASSES (TCACHE_MAX_SIZE / TCACHE_ALIGN)
+#define LARGE_CLASS NUM_CLASSES
+#define REFILL_BATCH 32                           // Сколько блоков брать у бэкенда за раз
+#define FLUSH_LIMIT 64                            // Порог размера корзины
+#define FLUSH_BATCH 32                            // Сколько блоков вернуть при переполнении
+#define CACHE_LINE 64
+#define DEAD_CACHE ((CacheBlock*)(uintptr_t)1)   // Голова очереди кэша завершившегося потока
+
+typedef struct ThreadCache ThreadCache;
+
+typedef struct CacheBlock {
+    ThreadCache* owner;          // NULL для крупных блоков
+    size_t cls;
+    struct CacheBlock* next;     // Лежит в полезной части, пока блок в кэше
+} CacheBlock;
+
+#define HEADER_SIZE offsetof(CacheBlock, next)
+
+typedef struct {
+    CacheBlock* head;
+    size_t count;
+} Bin;
+
+struct ThreadCache {
+    // Очередь возврата пишут чужие потоки, держим её на отдельной линии кэша
+    _Alignas(CACHE_LINE) _Atomic(CacheBlock*) remote;
+    _Alignas(CACHE_LINE) Bin bins[NUM_CLASSES];
+    TCache* parent;
+    ThreadCache* next;
+};
+
+struct TCache {
+    Allocator* backend;
+    TCacheAllocFunc alloc;
+    TCacheFreeFunc free;
+    int thread_safe;             // Бэкенд синхронизирует потоки сам
+    pthread_mutex_t lock;        // Защищает список кэшей и бэкенд, если он не thread_safe
+    pthread_key_t key;
+    unsigned long id;
+    ThreadCache* caches;
+};
+
+static atomic_ulong next_id = 1;
+static __thread unsigned long tls_id;
+static __thread ThreadCache* tls_cache;
+
+static inline void bin_push(Bin* bin, CacheBlock* block) {
+    block->next = bin->head;
+    bin->head = block;
+    bin->count++;
+}
+
+static inline void backend_lock(TCache* tcache) {
+    if (!tcache->thread_safe) pthread_mutex_lock(&tcache->lock);
+}
+
+static inline void backend_unlock(TCache* tcache) {
+    if (!tcache->thread_safe) pthread_mutex_unlock(&tcache->lock);
+}
+
+static void flush_bin(TCache* tcache, Bin* bin, size_t count) {
+    backend_lock(tcache);
+    while (bin->head && count--) {
+        CacheBlock* block = bin->head;
+        bin->head = block->next;
+        bin->count--;
+        tcache->free(tcache->backend, block);
+    }
+    backend_unlock(tcache);
+}
+
+static void refill_bin(TCache* tcache, ThreadCache* cache, size_t cls) {
+    size_t block_size = (cls + 1) * TCACHE_ALIGN + HEADER_SIZE;
+    backend_lock(tcache);
+    for (int i = 0; i < REFILL_BATCH; i++) {
+        CacheBlock* block = tcache->alloc(tcache->backend, block_size);
+        if (!block) break;
+        block->owner = cache;
+        block->cls = cls;
+        bin_push(&cache->bins[cls], block);
+    }
+    backend_unlock(tcache);
+}
+
+// Забираем всё, что вернули другие потоки, одной атомарной операцией.
+// У кэша завершившегося потока очередь пуста и помечена DEAD_CACHE
+static void drain_remote(ThreadCache* cache) {
+    CacheBlock* block = atomic_exchange_explicit(&cache->remote, NULL, memory_order_acquire);
+    if (block == DEAD_CACHE) return;
+    while (block) {
+        CacheBlock* next = block->next;
+        bin_push(&cache->bins[block->cls], block);
+        block = next;
+    }
+}
+
+static void release_cache(TCache* tcache, ThreadCache* cache) {
+    drain_remote(cache);
+    for (size_t cls = 0; cls < NUM_CLASSES; cls++) {
+        flush_bin(tcache, &cache->bins[cls], SIZE_MAX);
+    }
+}
+
+// Деструктор ключа: поток завершился, его блоки возвращаются бэкенду.
+// Очередь помечается DEAD_CACHE: дальше чужие потоки отдают блоки этого
+// кэша прямо бэкенду, а сам кэш подберёт следующий новый поток
+static void thread_exit(void* arg) {
+    ThreadCache* cache = arg;
+    TCache* tcache = cache->parent;
+    release_cache(tcache, cache);
+
+    // Пришедшее после drain_remote; в корзины не кладём - после пометки
+    // кэш может быть уже занят другим потоком
+    CacheBlock* block = atomic_exchange_explicit(&cache->remote, DEAD_CACHE, memory_order_acq_rel);
+    backend_lock(tcache);
+    while (block) {
+        CacheBlock* next = block->next;
+        tcache->free(tcache->backend, block);
+        block = next;
+    }
+    backend_unlock(tcache);
+    tls_id = 0;
+    tls_cache = NULL;
+}
+
+// Кэш завершившегося потока, если такой есть; вызывать под tcache->lock
+static ThreadCache* adopt_cache(TCache* tcache) {
+    for (ThreadCache* cache = tcache->caches; cache; cache = cache->next) {
+        if (atomic_load_explicit(&cache->remote, memory_order_acquire) == DEAD_CACHE) {
+            atomic_store_explicit(&cache->remote, NULL, memory_order_release);
+            return cache;
+        }
+    }
+    return NULL;
+}
+
+static ThreadCache* get_cache(TCache* tcache) {
+    if (tls_id == tcache->id) return tls_cache;
+
+    ThreadCache* cache = pthread_getspecific(tcache->key);
+    if (!cache) {
+        pthread_mutex_lock(&tcache->lock);
+        cache = adopt_cache(tcache);
+        pthread_mutex_unlock(&tcache->lock);
+    }
+    if (!cache) {
+        size_t size = (sizeof(ThreadCache) + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+        cache = aligned_alloc(CACHE_LINE, size);
+        if (!cache) return NULL;
+        memset(cache, 0, sizeof(ThreadCache));
+        atomic_init(&cache->remote, NULL);
+        cache->parent = tcache;
+
+        pthread_mutex_lock(&tcache->lock);
+        cache->next = tcache->caches;
+        tcache->caches = cache;
+        pthread_mutex_unlock(&tcache->lock);
+    }
+    pthread_setspecific(tcache->key, cache);
+
+    tls_id = tcache->id;
+    tls_cache = cache;
+    return cache;
+}
+
+TCache* tcache_create(Allocator* backend, TCacheAllocFunc alloc, TCacheFreeFunc free_func,
+                      int thread_safe) {
+    TCache* tcache = malloc(sizeof(TCache));
+    if (!tcache) return NULL;
+
+    if (pthread_key_create(&tcache->key, thread_exit) != 0) {
+        free(tcache);
+        return NULL;
+    }
+    pthread_mutex_init(&tcache->lock, NULL);
+    tcache->backend = backend;
+    tcache->alloc = alloc;
+    tcache->free = free_func;
+    tcache->thread_safe = thread_safe;
+    tcache->id = atomic_fetch_add(&next_id, 1);
+    tcache->caches = NULL;
+    return tcache;
+}
+
+void tcache_destroy(TCache* tcache) {
+    pthread_key_delete(tcache->key);
+    ThreadCache* cache = tcache->caches;
+    while (cache) {
+        ThreadCache* next = cache->next;
+        release_cache(tcache, cache);
+        free(cache);
+        cache = next;
+    }
+    if (tls_id == tcache->id) {
+        tls_id = 0;
+        tls_cache = NULL;
+    }
+    pthread_mutex_destroy(&tcache->lock);
+    free(tcache);
+}
+
+void* tcache_alloc(TCache* tcache, size_t size) {
+    if (size == 0) return NULL;
+
+    if (size > TCACHE_MAX_SIZE) {
+        backend_lock(tcache);
+        CacheBlock* block = tcache->alloc(tcache->backend, size + HEADER_SIZE);
+        backend_unlock(tcache);
+        if (!block) return NULL;
+        block->owner = NULL;
+        block->cls = LARGE_CLASS;
+        return (char*)block + HEADER_SIZE;
+    }
+
+    ThreadCache* cache = get_cache(tcache);
+    if (!cache) return NULL;
+
+    size_t cls = (size - 1) / TCACHE_ALIGN;
+    Bin* bin = &cache->bins[cls];
+    if (!bin->head) {
+        drain_remote(cache);
+        if (!bin->head) refill_bin(tcache, cache, cls);
+        if (!bin->head) return NULL;
+    }
+
+    CacheBlock* block = bin->head;
+    bin->head = block->next;
+    bin->count--;
+    return (char*)block + HEADER_SIZE;
+}
+
+void tcache_free(TCache* tcache, void* ptr) {
+    if (!ptr) return;
+
+    CacheBlock* block = (CacheBlock*)((char*)ptr - HEADER_SIZE);
+    if (block->cls == LARGE_CLASS) {
+        backend_lock(tcache);
+        tcache->free(tcache->backend, block);
+        backend_unlock(tcache);
+        return;
+    }
+
+    ThreadCache* cache = get_cache(tcache);
+    ThreadCache* owner = block->owner;
+    if (owner != cache) {
+        // Чужой блок: lock-free push в очередь владельца, а если владелец
+        // завершился - сразу бэкенду
+        CacheBlock* head = atomic_load_explicit(&owner->remote, memory_order_relaxed);
+        do {
+            if (head == DEAD_CACHE) {
+                backend_lock(tcache);
+                tcache->free(tcache->backend, block);
+                backend_unlock(tcache);
+                return;
+            }
+            block->next = head;
+        } while (!atomic_compare_exchange_weak_explicit(&owner->remote, &head, block,
+                                                        memory_order_release,
+                                                        memory_order_relaxed));
+        return;
+    }
+
+    Bin* bin = &cache->bins[block->cls];
+    bin_push(bin, block);
+    if (bin->count > FLUSH_LIMIT) {
+        flush_bin(tcache, bin, FLUSH_BATCH);
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef TCACHE_H
+#define TCACHE_H
+
+#include <stddef.h>
+#include "allocator.h"
+
+// Потоковый кэш мелких блоков поверх любого аллокатора с интерфейсом
+// allocator.h. Бэкенд вызывается пачками и под общим мьютексом, если он
+// сам не thread_safe; освобождения из чужих потоков возвращаются через
+// lock-free очередь. Кэш завершившегося потока переходит к новому потоку.
+
+typedef struct TCache TCache;
+
+typedef void* (*TCacheAllocFunc)(Allocator*, size_t);
+typedef void (*TCacheFreeFunc)(Allocator*, void*);
+
+// thread_safe - бэкенд можно вызывать из нескольких потоков без мьютекса
+TCache* tcache_create(Allocator* backend, TCacheAllocFunc alloc, TCacheFreeFunc free,
+                      int thread_safe);
+// Возвращает все закэшированные блоки бэкенду; вызывать, когда потоки
+// больше не обращаются к кэшу
+void tcache_destroy(TCache* tcache);
+void* tcache_alloc(TCache* tcache, size_t size);
+void tcache_free(TCache* tcache, void* ptr);
+
+#endif
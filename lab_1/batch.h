@@ -0,0 +1,19 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdint.h>
+
+// Кадры между parent и "./child batch" в режиме fanout: заголовок, затем
+// байты. В запросе - целые строки пачки (len байт), в ответе - ответы для
+// файла (len байт) и для экрана (screen_len байт) подряд. seq - номер
+// пачки во вводе: по нему parent выводит ответы в исходном порядке
+
+#define BATCH_SIZE 65536
+
+typedef struct {
+    uint64_t seq;
+    uint32_t len;
+    uint32_t screen_len;    // Только в ответе
+} BatchHeader;
+
+#endif
@@ -0,0 +1,22 @@
+#!/bin/sh
+# Сверяет файл режима fanout с однопроцессным copy, когда ввод приходит
+# кусками нечётного размера и обрывается посреди строк.
+# Запуск из каталога с собранными parent и child: ./check_fanout.sh [workers]
+set -e
+workers=${1:-4}
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+awk 'BEGIN { srand(7); for (i = 0; i < 300000; i++) {
+         n = int(rand() * 80); s = "";
+         for (j = 0; j < n; j++) s = s substr("abc xyz", int(rand() * 7) + 1, 1);
+         r = rand(); print s (r < 0.3 ? ";" : r < 0.5 ? "." : "") } }' > "$dir/input.txt"
+
+(echo "$dir/copy.txt"; cat "$dir/input.txt") | ./parent copy > /dev/null 2>&1
+(echo "$dir/fanout.txt"; dd if="$dir/input.txt" bs=4099 status=none) | ./parent fanout "$workers" > /dev/null 2>&1
+cmp "$dir/copy.txt" "$dir/fanout.txt"
+
+(echo "$dir/half.txt"; printf 'hello'; sleep 0.2; printf ' world;\n') | ./parent fanout "$workers" > /dev/null 2>&1
+grep -qx 'Валидная строка: hello world;' "$dir/half.txt"
+
+echo "fanout $workers: OK"
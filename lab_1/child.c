@@ -2,38 +2,193 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include "batch.h"
 
-#define BUFFER_SIZE 1024
-#define ERROR_BUFFER_SIZE 256
-
-int main() {
-    char input[BUFFER_SIZE];
-    char error_msg[ERROR_BUFFER_SIZE];
-
-    // Чтение из стандартного ввода (должно быть по pipe)
-    while (read(STDIN_FILENO, input, sizeof(input)) > 0) {
-        // Удаляем символ новой строки
-        input[strcspn(input, "\n")] = '\0';
-
-        // Проверяем окончание строки
-        if (input[strlen(input) - 1] == ';' || input[strlen(input) - 1] == '.') {
-            char tmp[1100];
-            int ret = snprintf(tmp, sizeof(tmp), "Валидная строка: %s\n", input);
-            if (ret < 0) {
-                abort();
-            }
-            write(STDERR_FILENO, tmp, strlen(tmp));
-            write(STDOUT_FILENO, tmp, strlen(tmp));
-        } else {
-            if (strlen(input)) {
-                int ret = snprintf(error_msg, sizeof(error_msg), "Не валидная строка: %s\n", input);
-                if (ret < 0) {
-                    abort();
-                }
-                write(STDOUT_FILENO, error_msg, strlen(error_msg));
-            }
+#define BLOCK_SIZE 65536
+#define OUTPUT_SIZE (2 * BLOCK_SIZE + 64)   // Влезает любой ответ на строку
+
+static const char VALID[] = "Валидная строка: ";
+static const char INVALID[] = "Не валидная строка: ";
+
+// Ответы копятся и уходят одним write на буфер, а не по два на строку:
+// валидные - на экран (stderr) и в файл (stdout), невалидные - только в файл
+typedef struct {
+    int fd;
+    size_t len;
+    size_t capacity;
+    char *data;
+} Output;
+
+static char file_buffer[OUTPUT_SIZE];
+static char screen_buffer[OUTPUT_SIZE];
+static Output to_file = { STDOUT_FILENO, 0, OUTPUT_SIZE, file_buffer };
+static Output to_screen = { STDERR_FILENO, 0, OUTPUT_SIZE, screen_buffer };
+
+static void write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        len -= written;
+    }
+}
+
+static void flush_output(Output *out) {
+    write_all(out->fd, out->data, out->len);
+    out->len = 0;
+}
+
+static void put_answer(Output *out, const char *prefix, size_t prefix_len,
+                       const char *line, size_t len) {
+    if (out->len + prefix_len + len + 1 > out->capacity) {
+        flush_output(out);
+    }
+    memcpy(out->data + out->len, prefix, prefix_len);
+    memcpy(out->data + out->len + prefix_len, line, len);
+    out->len += prefix_len + len;
+    out->data[out->len++] = '\n';
+}
+
+static void check_line(const char *line, size_t len) {
+    // Пустые строки пропускаются
+    if (len == 0) {
+        return;
+    }
+    if (line[len - 1] == ';' || line[len - 1] == '.') {
+        put_answer(&to_screen, VALID, sizeof(VALID) - 1, line, len);
+        put_answer(&to_file, VALID, sizeof(VALID) - 1, line, len);
+    } else {
+        put_answer(&to_file, INVALID, sizeof(INVALID) - 1, line, len);
+    }
+}
+
+// Строки пачки; последняя может быть без перевода строки
+static void check_lines(const char *data, size_t len) {
+    size_t start = 0;
+    const char *newline;
+    while ((newline = memchr(data + start, '\n', len - start)) != NULL) {
+        check_line(data + start, newline - (data + start));
+        start = newline - data + 1;
+    }
+    check_line(data + start, len - start);
+}
+
+static int read_full(int fd, void *data, size_t len) {
+    char *p = data;
+    while (len > 0) {
+        ssize_t got = read(fd, p, len);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return 0;
+        }
+        p += got;
+        len -= got;
+    }
+    return 1;
+}
+
+static void writev_all(int fd, struct iovec *iov, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return;
+        }
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+// Режим fanout: пачки с номерами от parent, ответ на пачку - один кадр,
+// заголовок и оба буфера одним writev. Буферы вмещают ответ на любую
+// пачку, поэтому сами не сбрасываются
+static int serve_batches(void) {
+    static char batch[BATCH_SIZE];
+    size_t capacity = BATCH_SIZE * (1 + sizeof(INVALID));
+    to_file.data = malloc(capacity);
+    to_screen.data = malloc(capacity);
+    if (!to_file.data || !to_screen.data) {
+        return EXIT_FAILURE;
+    }
+    to_file.capacity = to_screen.capacity = capacity;
+
+    BatchHeader header;
+    while (read_full(STDIN_FILENO, &header, sizeof(header))) {
+        if (header.len > BATCH_SIZE || !read_full(STDIN_FILENO, batch, header.len)) {
+            return EXIT_FAILURE;
+        }
+        check_lines(batch, header.len);
+
+        BatchHeader reply = { header.seq, (uint32_t)to_file.len, (uint32_t)to_screen.len };
+        struct iovec iov[3] = {
+            { &reply, sizeof(reply) },
+            { to_file.data, to_file.len },
+            { to_screen.data, to_screen.len },
+        };
+        writev_all(STDOUT_FILENO, iov, 3);
+        to_file.len = to_screen.len = 0;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "batch") == 0) {
+        return serve_batches();
+    }
+
+    static char input[BLOCK_SIZE];
+    size_t pending = 0;     // Начало строки без перевода строки с прошлого read
+
+    // Чтение из стандартного ввода (должно быть по pipe) большими блоками;
+    // строки ищутся memchr, а ответы на весь блок пишутся разом
+    while (1) {
+        ssize_t count = read(STDIN_FILENO, input + pending, sizeof(input) - pending);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
         }
+        size_t filled = pending + count;
+        size_t start = 0;
+        char *newline;
+        while ((newline = memchr(input + start, '\n', filled - start)) != NULL) {
+            check_line(input + start, newline - (input + start));
+            start = newline - input + 1;
+        }
+        // Строка длиннее блока проверяется по кускам
+        if (start == 0 && filled == sizeof(input)) {
+            check_line(input, filled);
+            start = filled;
+        }
+        pending = filled - start;
+        memmove(input, input + start, pending);
+
+        flush_output(&to_screen);
+        flush_output(&to_file);
     }
+    // Последняя строка без перевода строки
+    check_line(input, pending);
+    flush_output(&to_screen);
+    flush_output(&to_file);
 
     return 0;
 }
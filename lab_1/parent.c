@@ -1,34 +1,387 @@
+#define _GNU_SOURCE
+#include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <time.h>
 #include <sys/wait.h>
+#include "batch.h"
 
 #define BUFFER_SIZE 1024
 #define ERROR_BUFFER_SIZE 256
+#define BLOCK_SIZE 65536
+#define PIPE_SIZE (1 << 20)     // Больше данных за один splice и read у child
+#define MAX_WORKERS 64
+#define WORKER_DEPTH 2          // Пачек в работе на обработчик
+
+// copy - ввод и вывод child проходят через буфер parent,
+// splice - ядро переносит страницы stdin -> pipe1 и pipe2 -> файл само,
+// fanout - несколько child, каждому пачки строк по очереди
+typedef enum { MODE_COPY, MODE_SPLICE, MODE_FANOUT } Mode;
+
+// Обработчик режима fanout: запросы в to, ответы из from копятся в
+// replies, пока не подойдёт их очередь
+typedef struct {
+    pid_t pid;
+    int to;
+    int from;
+    char *replies;
+    size_t replies_off;
+    size_t replies_len;
+    size_t replies_cap;
+} Worker;
 
 void write_string(int fd, const char *str) {
     write(fd, str, strlen(str));
 }
 
+// По байту до перевода строки: всё, что после него, остаётся строками для child
 void read_string(int fd, char *buffer, size_t size) {
-    read(fd, buffer, size);
+    size_t len = 0;
+    while (len + 1 < size && read(fd, buffer + len, 1) == 1 && buffer[len] != '\n') {
+        len++;
+    }
+    buffer[len] = '\0';
 }
 
-int main() {
-    int pipe1[2];
-    int pipe2[2];
-    char filename[BUFFER_SIZE];
+static void write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        len -= written;
+    }
+}
+
+// Ввод блоками уходит в pipe1 как есть (строки режет child), ответы из
+// pipe2 тем временем пишутся в файл. Одновременно, а не по очереди:
+// иначе на большом вводе обе трубы заполняются, и процессы ждут друг друга.
+// В режиме splice байты не заходят в память parent. Если stdin или файл
+// splice не умеют (терминал, файл с O_APPEND), эта сторона копируется.
+// Возвращает, сколько байт ввода передано child
+static size_t pump(Mode mode, int input_fd, int to_child, int from_child, int file_descriptor) {
+    static char input[BLOCK_SIZE];
+    static char output[BLOCK_SIZE];
+    size_t input_len = 0, input_off = 0, total = 0;
+    int input_open = 1;
+    int splice_input = mode == MODE_SPLICE, splice_output = mode == MODE_SPLICE;
+    int input_ready = 0;    // splice: во вводе есть данные, ждём места в pipe1
+
+    fcntl(to_child, F_SETFL, fcntl(to_child, F_GETFL) | O_NONBLOCK);
+    while (1) {
+        struct pollfd fds[2] = { { from_child, POLLIN, 0 }, { -1, 0, 0 } };
+        if (input_off < input_len || input_ready) {
+            fds[1] = (struct pollfd){ to_child, POLLOUT, 0 };
+        } else if (input_open) {
+            fds[1] = (struct pollfd){ input_fd, POLLIN, 0 };
+        }
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[0].revents && splice_output) {
+            ssize_t moved = splice(from_child, NULL, file_descriptor, NULL, PIPE_SIZE,
+                                   SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (moved == 0) {
+                break;          // child закрыл вывод - всё записано
+            }
+            if (moved < 0 && errno == EINVAL) {
+                splice_output = 0;
+            } else if (moved < 0 && errno != EAGAIN && errno != EINTR) {
+                // Файл не принимает данные (ENOSPC, EIO, EFBIG): poll так и
+                // будет сообщать POLLIN. Дальше копированием, как и без
+                // splice: child дочитывается до конца, а запись, которой
+                // некуда деться, теряется, но parent не крутится вхолостую
+                perror("splice");
+                splice_output = 0;
+            }
+        } else if (fds[0].revents) {
+            ssize_t got = read(from_child, output, sizeof(output));
+            if (got == 0) {
+                break;
+            }
+            if (got > 0) {
+                write_all(file_descriptor, output, got);
+            }
+        }
+
+        if (fds[1].fd == input_fd && fds[1].revents) {
+            if (splice_input) {
+                input_ready = 1;
+                continue;
+            }
+            ssize_t got = read(input_fd, input, sizeof(input));
+            if (got > 0) {
+                input_len = got;
+                input_off = 0;
+                total += got;
+            } else if (got == 0 || errno != EINTR) {
+                input_open = 0;
+                close(to_child);
+            }
+        } else if (fds[1].fd == to_child && fds[1].revents && input_ready) {
+            // stdin готов, pipe1 неблокирующий: splice не уснёт ни на одной стороне
+            ssize_t moved = splice(input_fd, NULL, to_child, NULL, PIPE_SIZE,
+                                   SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (moved > 0) {
+                total += moved;
+                input_ready = 0;
+            } else if (moved < 0 && errno == EINVAL) {
+                splice_input = 0;
+                input_ready = 0;
+            } else if (moved == 0 || (errno != EAGAIN && errno != EINTR)) {
+                input_ready = 0;
+                input_open = 0;
+                close(to_child);
+            }
+        } else if (fds[1].fd == to_child && fds[1].revents) {
+            ssize_t put = write(to_child, input + input_off, input_len - input_off);
+            if (put > 0) {
+                input_off += put;
+            } else if (put < 0 && errno != EAGAIN && errno != EINTR) {
+                // child больше не читает: остаток ввода некому отдать
+                input_off = input_len;
+                input_open = 0;
+                close(to_child);
+            }
+        }
+    }
+    return total;
+}
+
+static int spawn_worker(Worker *worker) {
+    int requests[2], answers[2];
+    // O_CLOEXEC: после exec у обработчика не остаётся чужих концов труб,
+    // иначе он не увидит конец ввода
+    if (pipe2(requests, O_CLOEXEC) == -1 || pipe2(answers, O_CLOEXEC) == -1) {
+        return -1;
+    }
+    fcntl(answers[1], F_SETPIPE_SZ, PIPE_SIZE);
+    pid_t pid = fork();
+    if (pid == -1) {
+        return -1;
+    }
+    if (pid == 0) {
+        dup2(requests[0], STDIN_FILENO);
+        dup2(answers[1], STDOUT_FILENO);
+        char *args[] = {"./child", "batch", NULL};
+        execvp(args[0], args);
+        write_string(STDERR_FILENO, "Не удалось запустить дочерний процесс\n");
+        exit(EXIT_FAILURE);
+    }
+    close(requests[0]);
+    close(answers[1]);
+    fcntl(requests[1], F_SETFL, O_NONBLOCK);
+    fcntl(answers[0], F_SETFL, O_NONBLOCK);
+    *worker = (Worker){ pid, requests[1], answers[0], NULL, 0, 0, 0 };
+    return 0;
+}
+
+// Дочитывает, что есть в трубе ответов. 0 - обработчик закрыл вывод
+static int receive(Worker *worker) {
+    if (worker->replies_off == worker->replies_len) {
+        worker->replies_off = worker->replies_len = 0;
+    }
+    if (worker->replies_cap - worker->replies_len < PIPE_SIZE) {
+        memmove(worker->replies, worker->replies + worker->replies_off,
+                worker->replies_len - worker->replies_off);
+        worker->replies_len -= worker->replies_off;
+        worker->replies_off = 0;
+        if (worker->replies_cap - worker->replies_len < PIPE_SIZE) {
+            size_t cap = worker->replies_cap * 2 + PIPE_SIZE;
+            char *replies = realloc(worker->replies, cap);
+            if (!replies) {
+                return 0;
+            }
+            worker->replies = replies;
+            worker->replies_cap = cap;
+        }
+    }
+    ssize_t got = read(worker->from, worker->replies + worker->replies_len,
+                       worker->replies_cap - worker->replies_len);
+    if (got > 0) {
+        worker->replies_len += got;
+    }
+    return got != 0 && (got > 0 || errno == EAGAIN || errno == EINTR);
+}
+
+// Выводит ответ на пачку seq, если он уже пришёл целиком
+static int emit(Worker *worker, uint64_t seq, int file_descriptor) {
+    BatchHeader header;
+    size_t ready = worker->replies_len - worker->replies_off;
+    if (ready < sizeof(header)) {
+        return 0;
+    }
+    memcpy(&header, worker->replies + worker->replies_off, sizeof(header));
+    if (ready < sizeof(header) + header.len + header.screen_len) {
+        return 0;
+    }
+    if (header.seq != seq) {
+        write_string(STDERR_FILENO, "Ответы обработчика перепутаны\n");
+        exit(EXIT_FAILURE);
+    }
+    const char *data = worker->replies + worker->replies_off + sizeof(header);
+    write_all(file_descriptor, data, header.len);
+    write_all(STDERR_FILENO, data + header.len, header.screen_len);
+    worker->replies_off += sizeof(header) + header.len + header.screen_len;
+    return 1;
+}
+
+// Ввод режется на пачки по последнему переводу строки, пачка seq уходит
+// обработчику seq % workers. Каждый отвечает на свои пачки по порядку,
+// поэтому ответ на очередную пачку ждём у одного обработчика, а ответы
+// остальных копятся. В работе не больше WORKER_DEPTH пачек на
+// обработчика: память на ответы ограничена.
+// Возвращает, сколько байт ввода передано
+static size_t fan_out(int workers, int input_fd, int file_descriptor) {
+    Worker worker[MAX_WORKERS];
+    for (int k = 0; k < workers; k++) {
+        if (spawn_worker(&worker[k]) != 0) {
+            write_string(STDOUT_FILENO, "Не удалось создать процесс\n");
+            exit(EXIT_FAILURE);
+        }
+    }
 
-    if (pipe(pipe1) == -1 || pipe(pipe2) == -1) {
-        write_string(STDOUT_FILENO,"Failed to create pipes");
+    static char input[BATCH_SIZE];
+    static char batch[sizeof(BatchHeader) + BATCH_SIZE];
+    size_t pending = 0, batch_len = 0, batch_off = 0, total = 0;
+    uint64_t next_send = 0, next_emit = 0;
+    int input_open = 1, inputs_closed = 0;
+
+    while (input_open || batch_len > 0 || next_emit < next_send) {
+        struct pollfd fds[MAX_WORKERS + 1];
+        for (int k = 0; k < workers; k++) {
+            fds[k] = (struct pollfd){ worker[k].from, POLLIN, 0 };
+        }
+        fds[workers] = (struct pollfd){ -1, 0, 0 };
+        if (batch_len > 0) {
+            fds[workers] = (struct pollfd){ worker[next_send % workers].to, POLLOUT, 0 };
+        } else if (input_open && next_send - next_emit < (uint64_t)workers * WORKER_DEPTH) {
+            fds[workers] = (struct pollfd){ input_fd, POLLIN, 0 };
+        }
+        if (poll(fds, workers + 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        for (int k = 0; k < workers; k++) {
+            if (fds[k].revents && !receive(&worker[k])) {
+                close(worker[k].from);
+                worker[k].from = -1;
+            }
+        }
+        while (next_emit < next_send && emit(&worker[next_emit % workers], next_emit, file_descriptor)) {
+            next_emit++;
+        }
+        if (next_emit < next_send && worker[next_emit % workers].from < 0) {
+            write_string(STDERR_FILENO, "Обработчик завершился раньше времени\n");
+            break;
+        }
+
+        if (fds[workers].fd == input_fd && fds[workers].revents) {
+            ssize_t got = read(input_fd, input + pending, sizeof(input) - pending);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            size_t filled = pending + (got > 0 ? got : 0);
+            size_t size = filled;
+            if (got > 0) {
+                total += got;
+                // Пачка - до последнего перевода строки; строка длиннее
+                // пачки идёт кусками
+                char *newline = memrchr(input, '\n', filled);
+                size = newline ? (size_t)(newline - input + 1) : (filled == sizeof(input) ? filled : 0);
+            } else {
+                input_open = 0;
+            }
+            if (size > 0) {
+                BatchHeader header = { next_send, (uint32_t)size, 0 };
+                memcpy(batch, &header, sizeof(header));
+                memcpy(batch + sizeof(header), input, size);
+                batch_len = sizeof(header) + size;
+                batch_off = 0;
+                memmove(input, input + size, filled - size);
+            }
+            // Хвост без перевода строки ждёт следующего read, а не затирается им
+            pending = filled - size;
+        } else if (fds[workers].revents) {
+            ssize_t put = write(fds[workers].fd, batch + batch_off, batch_len - batch_off);
+            if (put > 0) {
+                batch_off += put;
+            } else if (put < 0 && errno != EAGAIN && errno != EINTR) {
+                write_string(STDERR_FILENO, "Обработчик завершился раньше времени\n");
+                break;
+            }
+            if (batch_off == batch_len) {
+                batch_len = 0;
+                next_send++;
+            }
+        }
+
+        if (!input_open && batch_len == 0 && !inputs_closed) {
+            for (int k = 0; k < workers; k++) {
+                close(worker[k].to);
+            }
+            inputs_closed = 1;
+        }
+    }
+
+    if (!inputs_closed) {
+        for (int k = 0; k < workers; k++) {
+            close(worker[k].to);
+        }
+    }
+    for (int k = 0; k < workers; k++) {
+        if (worker[k].from >= 0) {
+            close(worker[k].from);
+        }
+        waitpid(worker[k].pid, NULL, 0);
+        free(worker[k].replies);
+    }
+    return total;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    Mode mode = MODE_COPY;
+    int workers = 1;
+    if (argc > 1) {
+        if (strcmp(argv[1], "splice") == 0) {
+            mode = MODE_SPLICE;
+        } else if (strcmp(argv[1], "fanout") == 0) {
+            mode = MODE_FANOUT;
+            workers = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        } else if (strcmp(argv[1], "copy") != 0) {
+            workers = 0;
+        }
+    }
+    if (workers < 1 || workers > MAX_WORKERS) {
+        write_string(STDOUT_FILENO, "Использование: ./parent [copy|splice|fanout [workers]]\n");
         exit(EXIT_FAILURE);
     }
 
+    char filename[BUFFER_SIZE];
     const char *prompt = "Введите имя файла: ";
     write_string(STDOUT_FILENO, prompt);
     read_string(STDIN_FILENO, filename, sizeof(filename));
-    filename[strcspn(filename, "\n")] = '\0'; // Удаляем символ новой строки
 
     int file_descriptor = open(filename, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
     if (file_descriptor == -1) {
@@ -36,53 +389,60 @@ int main() {
         exit(EXIT_FAILURE);
     }
 
-    pid_t child_pid = fork();
-    if (child_pid == -1) {
-        write_string(STDOUT_FILENO,"Не удалось создать процесс");
-        exit(EXIT_FAILURE);
-    }
+    const char *input_prompt = "Введите строки (CTRL+D для завершения):\n";
+    double start = 0;
+    size_t total;
+    if (mode == MODE_FANOUT) {
+        write_string(STDOUT_FILENO, input_prompt);
+        start = now_seconds();
+        total = fan_out(workers, STDIN_FILENO, file_descriptor);
+    } else {
+        int pipe1[2];
+        int pipe2[2];
+        if (pipe(pipe1) == -1 || pipe(pipe2) == -1) {
+            write_string(STDOUT_FILENO,"Failed to create pipes");
+            exit(EXIT_FAILURE);
+        }
+        // Не получится - останутся обычные 64 КБ
+        fcntl(pipe1[1], F_SETPIPE_SZ, PIPE_SIZE);
+        fcntl(pipe2[1], F_SETPIPE_SZ, PIPE_SIZE);
 
-    if (child_pid == 0) {
-        close(pipe1[1]);
-        close(pipe2[0]);
+        pid_t child_pid = fork();
+        if (child_pid == -1) {
+            write_string(STDOUT_FILENO,"Не удалось создать процесс");
+            exit(EXIT_FAILURE);
+        }
 
-        dup2(pipe1[0], STDIN_FILENO);
-        dup2(pipe2[1], STDOUT_FILENO);
+        if (child_pid == 0) {
+            close(pipe1[1]);
+            close(pipe2[0]);
 
-        char *args[] = {"./child", NULL};
-        execvp(args[0], args);
-        write_string(STDOUT_FILENO,"Не удалось запустить дочерний процесс");
-        exit(EXIT_FAILURE);
-    } else {
-        char input[BUFFER_SIZE];
-        char valid_msg[BUFFER_SIZE];
+            dup2(pipe1[0], STDIN_FILENO);
+            dup2(pipe2[1], STDOUT_FILENO);
 
+            char *args[] = {"./child", NULL};
+            execvp(args[0], args);
+            write_string(STDOUT_FILENO,"Не удалось запустить дочерний процесс");
+            exit(EXIT_FAILURE);
+        }
         close(pipe1[0]);
         close(pipe2[1]);
 
-        const char *input_prompt = "Введите строки (CTRL+D для завершения):\n";
         write_string(STDOUT_FILENO, input_prompt);
-
-        while (read(STDIN_FILENO, input, sizeof(input)) > 0) {
-            input[strcspn(input, "\n")] = '\0'; // Удаляем символ новой строки
-            write(pipe1[1], input, strlen(input) + 1);
-        }
-        close(pipe1[1]);
-
-        while (1) {
-            ssize_t bytes_read = read(pipe2[0], valid_msg, sizeof(valid_msg));
-            if (bytes_read > 0) {
-                valid_msg[bytes_read] = '\0'; // Завершение строки
-                write(file_descriptor, valid_msg, strlen(valid_msg)); // Запись валидной строки в файл
-            } else if (bytes_read == 0) {
-                break; // Конец чтения
-            }
-        }
+        start = now_seconds();
+        total = pump(mode, STDIN_FILENO, pipe1[1], pipe2[0], file_descriptor);
 
         wait(NULL);
         close(pipe2[0]);
-        close(file_descriptor);
     }
+    double elapsed = now_seconds() - start;
+    close(file_descriptor);
+
+    const char *names[] = { "copy", "splice", "fanout" };
+    char report[BUFFER_SIZE];
+    snprintf(report, sizeof(report), "Режим %s (процессов: %d): %.1f МБ за %.3f с, %.1f МБ/с\n",
+             names[mode], workers, total / 1e6, elapsed, elapsed > 0 ? total / 1e6 / elapsed : 0.0);
+    write_string(STDOUT_FILENO, report);
 
     return 0;
-}
\ No newline at end of file
+}
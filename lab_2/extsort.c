@@ -0,0 +1,248 @@
+#include "extsort.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Ввод-вывод крупными последовательными кусками: вход и серии читаются
+// через mmap с MADV_SEQUENTIAL (ядро читает вперёд, пока мы считаем,
+// и быстрее отпускает прочитанное), серии пишутся write() целиком,
+// результат пишется в заранее выделенный на диске и отображённый файл
+
+typedef struct {
+    const int *pos;
+    const int *end;
+} Run;
+
+static int write_all(int fd, const void *data, size_t size) {
+    const char *p = data;
+    while (size > 0) {
+        ssize_t written = write(fd, p, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += written;
+        size -= written;
+    }
+    return 0;
+}
+
+static int *map_file(int fd, size_t size, int prot) {
+    void *p = mmap(NULL, size, prot, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+    madvise(p, size, MADV_SEQUENTIAL);
+    return p;
+}
+
+// Исчерпанная серия больше любой другой, при равных головах меньше
+// серия с меньшим номером - порядок слияния не зависит от дерева
+static int run_less(const Run *runs, size_t x, size_t y) {
+    if (runs[x].pos == runs[x].end) {
+        return 0;
+    }
+    if (runs[y].pos == runs[y].end) {
+        return 1;
+    }
+    return *runs[x].pos < *runs[y].pos || (*runs[x].pos == *runs[y].pos && x < y);
+}
+
+// Дерево проигравших: tree[1..k) хранят проигравшего в узле, листья-серии
+// неявно стоят на местах k..2k-1, tree[0] - общий победитель. После
+// выдачи элемента победитель переигрывает только путь до корня: log k
+// сравнений, причём с уже известными соперниками
+static size_t tree_init(const Run *runs, size_t *tree, size_t k, size_t node) {
+    if (node >= k) {
+        return node - k;
+    }
+    size_t left = tree_init(runs, tree, k, 2 * node);
+    size_t right = tree_init(runs, tree, k, 2 * node + 1);
+    if (run_less(runs, right, left)) {
+        tree[node] = left;
+        return right;
+    }
+    tree[node] = right;
+    return left;
+}
+
+static void tree_replay(const Run *runs, size_t *tree, size_t k, size_t winner) {
+    for (size_t node = (winner + k) / 2; node > 0; node /= 2) {
+        if (run_less(runs, tree[node], winner)) {
+            size_t loser = winner;
+            winner = tree[node];
+            tree[node] = loser;
+        }
+    }
+    tree[0] = winner;
+}
+
+static void merge_runs_to(const int *runs_map, size_t n, size_t chunk_elems,
+                          size_t num_runs, Run *runs, size_t *tree, int *out) {
+    for (size_t r = 0; r < num_runs; r++) {
+        size_t start = r * chunk_elems;
+        size_t end = start + chunk_elems < n ? start + chunk_elems : n;
+        runs[r].pos = runs_map + start;
+        runs[r].end = runs_map + end;
+    }
+    tree[0] = tree_init(runs, tree, num_runs, 1);
+
+    for (size_t i = 0; i < n; i++) {
+        size_t winner = tree[0];
+        out[i] = *runs[winner].pos++;
+        tree_replay(runs, tree, num_runs, winner);
+    }
+}
+
+int external_sort(const char *input, const char *output, size_t chunk_elems,
+                  chunk_sort_fn sort_chunk, void *arg) {
+    int result = -1;
+    int in_fd = -1, out_fd = -1, runs_fd = -1;
+    int *in_map = NULL, *runs_map = NULL, *out_map = NULL;
+    int *chunk = NULL;
+    Run *runs = NULL;
+    size_t *tree = NULL;
+    char *runs_path = NULL;
+    size_t bytes = 0;
+
+    in_fd = open(input, O_RDONLY);
+    if (in_fd < 0) {
+        perror(input);
+        goto done;
+    }
+    struct stat st;
+    if (fstat(in_fd, &st) < 0) {
+        perror("fstat");
+        goto done;
+    }
+    bytes = (size_t)st.st_size;
+    if (bytes % sizeof(int) != 0) {
+        fprintf(stderr, "Error: %s size is not a multiple of %zu bytes\n", input, sizeof(int));
+        goto done;
+    }
+    size_t n = bytes / sizeof(int);
+
+    out_fd = open(output, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0) {
+        perror(output);
+        goto done;
+    }
+    if (n == 0) {
+        result = 0;
+        goto done;
+    }
+
+    if (chunk_elems > n) {
+        chunk_elems = n;
+    }
+    size_t num_runs = (n + chunk_elems - 1) / chunk_elems;
+    chunk = malloc(2 * chunk_elems * sizeof(int));
+    in_map = map_file(in_fd, bytes, PROT_READ);
+    if (!chunk || !in_map) {
+        if (!chunk) {
+            perror("malloc for chunk");
+        }
+        goto done;
+    }
+
+    // Всё поместилось в один кусок - серии не нужны
+    if (num_runs == 1) {
+        memcpy(chunk, in_map, bytes);
+        sort_chunk(chunk, chunk + chunk_elems, n, arg);
+        if (write_all(out_fd, chunk, bytes) < 0) {
+            perror("write");
+            goto done;
+        }
+        result = 0;
+        goto done;
+    }
+
+    // Серии лежат подряд в одном файле: серия r начинается с r * chunk_elems
+    size_t path_len = strlen(output) + sizeof(".runs");
+    runs_path = malloc(path_len);
+    if (!runs_path) {
+        perror("malloc");
+        goto done;
+    }
+    snprintf(runs_path, path_len, "%s.runs", output);
+    runs_fd = open(runs_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (runs_fd < 0) {
+        perror(runs_path);
+        goto done;
+    }
+    unlink(runs_path);
+
+    for (size_t r = 0; r < num_runs; r++) {
+        size_t start = r * chunk_elems;
+        size_t len = start + chunk_elems < n ? chunk_elems : n - start;
+        memcpy(chunk, in_map + start, len * sizeof(int));
+        sort_chunk(chunk, chunk + chunk_elems, len, arg);
+        if (write_all(runs_fd, chunk, len * sizeof(int)) < 0) {
+            perror("write run");
+            goto done;
+        }
+    }
+    // Память под куски слиянию не нужна
+    free(chunk);
+    chunk = NULL;
+    munmap(in_map, bytes);
+    in_map = NULL;
+
+    // Место под результат выделяется заранее: нехватка диска - ошибка
+    // здесь, а не SIGBUS при записи в отображение
+    int err = posix_fallocate(out_fd, 0, (off_t)bytes);
+    if (err != 0) {
+        errno = err;
+        perror("posix_fallocate");
+        goto done;
+    }
+    runs_map = map_file(runs_fd, bytes, PROT_READ);
+    out_map = map_file(out_fd, bytes, PROT_READ | PROT_WRITE);
+    runs = malloc(num_runs * sizeof(Run));
+    tree = malloc(num_runs * sizeof(size_t));
+    if (!runs_map || !out_map || !runs || !tree) {
+        if (!runs || !tree) {
+            perror("malloc");
+        }
+        goto done;
+    }
+    merge_runs_to(runs_map, n, chunk_elems, num_runs, runs, tree, out_map);
+    if (msync(out_map, bytes, MS_SYNC) < 0) {
+        perror("msync");
+        goto done;
+    }
+    result = 0;
+
+done:
+    if (out_map) {
+        munmap(out_map, bytes);
+    }
+    if (runs_map) {
+        munmap(runs_map, bytes);
+    }
+    if (in_map) {
+        munmap(in_map, bytes);
+    }
+    free(tree);
+    free(runs);
+    free(chunk);
+    free(runs_path);
+    if (runs_fd >= 0) {
+        close(runs_fd);
+    }
+    if (out_fd >= 0) {
+        close(out_fd);
+    }
+    if (in_fd >= 0) {
+        close(in_fd);
+    }
+    return result;
+}
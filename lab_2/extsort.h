@@ -0,0 +1,20 @@
+#ifndef EXTSORT_H
+#define EXTSORT_H
+
+#include <stddef.h>
+
+// Внешняя сортировка двоичного файла int (родной порядок байт), который
+// не обязан помещаться в память: файл режется на куски по chunk_elems,
+// каждый сортируется в памяти и пишется серией во временный файл, затем
+// серии сливаются k-путевым слиянием на дереве проигравших
+
+// Сортирует array[0..n); buffer того же размера - рабочая память
+typedef void (*chunk_sort_fn)(int *array, int *buffer, size_t n, void *arg);
+
+// Памяти нужно 2 * chunk_elems * sizeof(int). Временный файл серий
+// создаётся рядом с output и удаляется сразу после открытия.
+// Возвращает 0 или -1 (причина уже выведена через perror)
+int external_sort(const char *input, const char *output, size_t chunk_elems,
+                  chunk_sort_fn sort_chunk, void *arg);
+
+#endif
@@ -0,0 +1,291 @@
+#include "natural.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "psort_template.h"
+
+#define MIN_PART 65536      // Меньшие части не окупают задачу поиска серий
+#define MIN_GALLOP 7        // Столько побед подряд - и слияние переходит на галоп
+
+typedef struct {
+    int *array;
+    int *buffer;
+    size_t n;
+    int parts;
+    size_t capacity;        // Мест под начала серий у каждой части
+    size_t *starts;         // [part * capacity + k]: начало k-й серии части
+    size_t *counts;         // [part]: серий найдено
+    int *overflow;          // [part]: серий больше capacity - данные случайные
+    size_t *bounds;         // Границы склеенных серий, bounds[runs] == n
+    size_t runs;
+} Natural;
+
+typedef struct {
+    Natural *ns;
+    int lo;
+    int hi;
+} PartRange;
+
+typedef struct {
+    Natural *ns;
+    size_t lo;              // Серии [lo, hi)
+    size_t hi;
+    int to_buffer;
+} TreeArgs;
+
+static inline size_t part_start(const Natural *ns, int part) {
+    size_t base = ns->n / ns->parts, extra = ns->n % ns->parts;
+    return base * part + ((size_t)part < extra ? (size_t)part : extra);
+}
+
+static void reverse(int *array, size_t n) {
+    for (size_t i = 0, j = n - 1; i < j; i++, j--) {
+        int tmp = array[i];
+        array[i] = array[j];
+        array[j] = tmp;
+    }
+}
+
+// Серии ищутся только внутри части; на стыках частей их склеит
+// join_runs. Направление серии решает первая неравная пара, убывающая
+// серия - невозрастающая: равные int неразличимы, и разворот не мешает
+// склеить серию из повторов
+static void find_runs(Natural *ns, int part) {
+    int *a = ns->array;
+    size_t *starts = ns->starts + part * ns->capacity;
+    size_t count = 0;
+    size_t end = part_start(ns, part + 1);
+
+    for (size_t i = part_start(ns, part); i < end; ) {
+        if (count == ns->capacity) {
+            ns->overflow[part] = 1;
+            return;
+        }
+        starts[count++] = i;
+        size_t j = i + 1;
+        while (j < end && a[j] == a[j - 1]) {
+            j++;
+        }
+        if (j < end && a[j] < a[j - 1]) {
+            while (j < end && a[j] <= a[j - 1]) {
+                j++;
+            }
+            reverse(a + i, j - i);
+        } else {
+            while (j < end && a[j] >= a[j - 1]) {
+                j++;
+            }
+        }
+        i = j;
+    }
+    ns->counts[part] = count;
+}
+
+static void run_parts(void *arg) {
+    PartRange *range = (PartRange *)arg;
+    if (range->hi - range->lo == 1) {
+        find_runs(range->ns, range->lo);
+        return;
+    }
+    int mid = (range->lo + range->hi) / 2;
+    PartRange left = { range->ns, range->lo, mid };
+    PartRange right = { range->ns, mid, range->hi };
+
+    Task leftTask;
+    pool_spawn(&leftTask, run_parts, &left);
+    run_parts(&right);
+    pool_sync(&leftTask);
+}
+
+// Серия продолжает предыдущую, если на стыке нет спуска: так склеиваются
+// серии соседних частей и развёрнутая убывающая серия со следующей
+static void join_runs(Natural *ns) {
+    const int *a = ns->array;
+    size_t runs = 0;
+    for (int p = 0; p < ns->parts; p++) {
+        const size_t *starts = ns->starts + p * ns->capacity;
+        for (size_t k = 0; k < ns->counts[p]; k++) {
+            size_t s = starts[k];
+            if (runs > 0 && a[s - 1] <= a[s]) {
+                continue;
+            }
+            ns->bounds[runs++] = s;
+        }
+    }
+    ns->bounds[runs] = ns->n;
+    ns->runs = runs;
+}
+
+// Первый индекс с a[i] > key (gallop_right) или a[i] >= key (gallop_left):
+// шаги 1, 2, 4, ... от начала, затем двоичный поиск в последнем шаге.
+// Длинный кусок находится за O(log длины), а не поэлементно
+static size_t gallop_right(int key, const int *a, size_t n) {
+    size_t bound = 1;
+    while (bound < n && a[bound] <= key) {
+        bound *= 2;
+    }
+    size_t lo = bound / 2, hi = bound < n ? bound : n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (a[mid] <= key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static size_t gallop_left(int key, const int *a, size_t n) {
+    size_t bound = 1;
+    while (bound < n && a[bound] < key) {
+        bound *= 2;
+    }
+    size_t lo = bound / 2, hi = bound < n ? bound : n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (a[mid] < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Слияние как в TimSort: поэлементно, пока побеждают вперемешку; когда
+// одна серия выигрывает MIN_GALLOP раз подряд, её кусок до следующего
+// элемента другой серии ищется галопом и копируется целиком
+static void gallop_merge(const int *a, size_t na, const int *b, size_t nb, int *dst) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        size_t wins_a = 0, wins_b = 0;
+        while (i < na && j < nb && wins_a < MIN_GALLOP && wins_b < MIN_GALLOP) {
+            if (b[j] < a[i]) {
+                dst[k++] = b[j++];
+                wins_b++;
+                wins_a = 0;
+            } else {
+                dst[k++] = a[i++];
+                wins_a++;
+                wins_b = 0;
+            }
+        }
+        if (i == na || j == nb) {
+            break;
+        }
+        size_t run = gallop_right(b[j], a + i, na - i);
+        memcpy(dst + k, a + i, run * sizeof(int));
+        k += run;
+        i += run;
+        if (i == na) {
+            break;
+        }
+        run = gallop_left(a[i], b + j, nb - j);
+        memcpy(dst + k, b + j, run * sizeof(int));
+        k += run;
+        j += run;
+    }
+    memcpy(dst + k, a + i, (na - i) * sizeof(int));
+    k += na - i;
+    memcpy(dst + k, b + j, (nb - j) * sizeof(int));
+}
+
+// Деление крупного слияния по co-rank и его задачи пула - из движка
+// psort_template.h, как в sort.c: правило равных и порог там одни
+DEFINE_PSORT_MERGE(gallop, int, LESS_VALUE, gallop_merge)
+
+// Дерево слияний по сериям [lo, hi), делённым по середине элементов, а не
+// числа серий: длинная серия не тянет за собой лишних уровней. Как и в
+// sort.c, уровни чередуют array и buffer
+static void merge_tree(void *arg) {
+    TreeArgs *t = (TreeArgs *)arg;
+    Natural *ns = t->ns;
+    const size_t *bounds = ns->bounds;
+    size_t start = bounds[t->lo], end = bounds[t->hi];
+
+    if (t->hi - t->lo == 1) {
+        if (t->to_buffer) {
+            memcpy(ns->buffer + start, ns->array + start, (end - start) * sizeof(int));
+        }
+        return;
+    }
+
+    size_t half = start + (end - start) / 2;
+    size_t lo = t->lo + 1, hi = t->hi - 1;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (bounds[mid] < half) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    size_t split = lo;
+
+    TreeArgs left = { ns, t->lo, split, !t->to_buffer };
+    TreeArgs right = { ns, split, t->hi, !t->to_buffer };
+    if (end - start <= PSORT_GRAIN) {
+        merge_tree(&left);
+        merge_tree(&right);
+    } else {
+        Task leftTask;
+        pool_spawn(&leftTask, merge_tree, &left);
+        merge_tree(&right);
+        pool_sync(&leftTask);
+    }
+
+    const int *src = t->to_buffer ? ns->array : ns->buffer;
+    int *dst = t->to_buffer ? ns->buffer : ns->array;
+    size_t mid = bounds[split];
+    gallop_MergeArgs merge = { src + start, mid - start, src + mid, end - mid, dst + start };
+    gallop_pool_merge(&merge);
+}
+
+static void natural_root(void *arg) {
+    Natural *ns = (Natural *)arg;
+    PartRange range = { ns, 0, ns->parts };
+    run_parts(&range);
+    for (int p = 0; p < ns->parts; p++) {
+        if (ns->overflow[p]) {
+            ns->runs = 0;
+            return;
+        }
+    }
+    join_runs(ns);
+    if (ns->runs > 1 && ns->runs <= ns->n / NATURAL_MIN_RUN) {
+        TreeArgs tree = { ns, 0, ns->runs, 0 };
+        merge_tree(&tree);
+    }
+}
+
+int natural_sort(Pool *pool, int *array, int *buffer, size_t n) {
+    if (n < 2) {
+        return 1;
+    }
+    int parts = pool_size(pool);
+    if ((size_t)parts > n / MIN_PART) {
+        parts = n / MIN_PART > 0 ? (int)(n / MIN_PART) : 1;
+    }
+
+    Natural ns = { array, buffer, n, parts, 0, NULL, NULL, NULL, NULL, 0 };
+    // Части с более частыми сериями дальше не смотрим
+    ns.capacity = (n / parts + 1) / NATURAL_MIN_RUN + 2;
+    ns.starts = malloc(parts * ns.capacity * sizeof(size_t));
+    ns.counts = calloc(parts, sizeof(size_t));
+    ns.overflow = calloc(parts, sizeof(int));
+    ns.bounds = malloc((parts * ns.capacity + 1) * sizeof(size_t));
+    if (!ns.starts || !ns.counts || !ns.overflow || !ns.bounds) {
+        perror("malloc for natural runs");
+        exit(EXIT_FAILURE);
+    }
+
+    pool_run(pool, natural_root, &ns);
+    int sorted = ns.runs == 1 || (ns.runs > 1 && ns.runs <= n / NATURAL_MIN_RUN);
+
+    free(ns.starts);
+    free(ns.counts);
+    free(ns.overflow);
+    free(ns.bounds);
+    return sorted;
+}
@@ -0,0 +1,20 @@
+#ifndef NATURAL_H
+#define NATURAL_H
+
+#include <stddef.h>
+#include "pool.h"
+
+// Естественная сортировка слиянием: потоки пула параллельно находят
+// готовые серии (неубывающие и невозрастающие, последние
+// разворачиваются на месте), соседние серии, которые продолжают друг
+// друга, склеиваются, и серии сливаются с галопом - длинные куски
+// одной серии переносятся целиком. Упорядоченный и обратный вход -
+// один проход.
+//
+// Возвращает 1, если массив отсортирован. 0 - серии в среднем короче
+// NATURAL_MIN_RUN (случайные данные): тогда развёрнуты лишь убывающие
+// куски, и массив надо сортировать обычным способом; buffer не тронут
+#define NATURAL_MIN_RUN 32
+int natural_sort(Pool *pool, int *array, int *buffer, size_t n);
+
+#endif
@@ -0,0 +1,266 @@
+#include "pool.h"
+#include "trace.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEQUE_SIZE 4096     // Степень двойки; глубина fork/join сортировки ~ log n
+#define SPIN_ROUNDS 64      // Попыток украсть работу перед сном
+#define CACHE_LINE 64
+
+// Дека Chase-Lev фиксированного размера: bottom меняет только владелец,
+// top сдвигают CAS'ом воры и владелец при снятии последней задачи
+typedef struct {
+    _Alignas(CACHE_LINE) atomic_long top;
+    _Alignas(CACHE_LINE) atomic_long bottom;
+    _Alignas(CACHE_LINE) Task *_Atomic tasks[DEQUE_SIZE];
+} Deque;
+
+typedef struct {
+    Deque deque;
+    Pool *pool;
+    unsigned rng;
+    pthread_t thread;
+} Worker;
+
+struct Pool {
+    int num_workers;
+    Worker *workers;          // workers[0] - поток, вызвавший pool_run
+    atomic_int stop;
+    atomic_int sleeping;
+    atomic_uint generation;   // Меняется при появлении работы для спящих
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+};
+
+static __thread Worker *current_worker = NULL;
+
+static int deque_push(Deque *deque, Task *task) {
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (b - t >= DEQUE_SIZE) {
+        return 0;
+    }
+    atomic_store_explicit(&deque->tasks[b & (DEQUE_SIZE - 1)], task, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_release);
+    return 1;
+}
+
+static Task *deque_take(Deque *deque) {
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (t > b) {
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+    Task *task = atomic_load_explicit(&deque->tasks[b & (DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (t == b) {
+        // Последняя задача: соревнуемся с ворами
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+                                                     memory_order_seq_cst,
+                                                     memory_order_relaxed)) {
+            task = NULL;
+        }
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+static Task *deque_steal(Deque *deque) {
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (t >= b) {
+        return NULL;
+    }
+    Task *task = atomic_load_explicit(&deque->tasks[t & (DEQUE_SIZE - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+                                                 memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return NULL;
+    }
+    return task;
+}
+
+static void run_task(Task *task) {
+    task->fn(task->arg);
+    atomic_store_explicit(&task->done, 1, memory_order_release);
+}
+
+// Жертва выбирается случайно, чтобы воры не толпились у одной деки
+static Task *steal_any(Worker *self) {
+    Pool *pool = self->pool;
+    if (pool->num_workers < 2) {
+        return NULL;
+    }
+    self->rng ^= self->rng << 13;
+    self->rng ^= self->rng >> 17;
+    self->rng ^= self->rng << 5;
+    int start = self->rng % pool->num_workers;
+    for (int i = 0; i < pool->num_workers; i++) {
+        Worker *victim = &pool->workers[(start + i) % pool->num_workers];
+        if (victim == self) {
+            continue;
+        }
+        Task *task = deque_steal(&victim->deque);
+        if (task) {
+            return task;
+        }
+    }
+    return NULL;
+}
+
+static Task *find_work(Worker *self) {
+    Task *task = deque_take(&self->deque);
+    return task ? task : steal_any(self);
+}
+
+static void *worker_main(void *arg) {
+    Worker *self = arg;
+    Pool *pool = self->pool;
+    current_worker = self;
+
+    while (!atomic_load(&pool->stop)) {
+        Task *task = find_work(self);
+        if (task) {
+            run_task(task);
+            continue;
+        }
+
+        // Простой считается с первой неудачной попытки найти работу
+        uint64_t idle = trace_begin();
+        for (int i = 0; i < SPIN_ROUNDS && !task; i++) {
+            sched_yield();
+            task = find_work(self);
+        }
+        if (!task) {
+            // Объявляем себя спящим до последней проверки: тогда либо она
+            // увидит новую задачу, либо pool_spawn увидит спящего и разбудит
+            unsigned seen = atomic_load(&pool->generation);
+            atomic_fetch_add(&pool->sleeping, 1);
+            task = find_work(self);
+            if (!task) {
+                pthread_mutex_lock(&pool->lock);
+                while (!atomic_load(&pool->stop) && atomic_load(&pool->generation) == seen) {
+                    pthread_cond_wait(&pool->wake, &pool->lock);
+                }
+                pthread_mutex_unlock(&pool->lock);
+            }
+            atomic_fetch_sub(&pool->sleeping, 1);
+        }
+        trace_end(TRACE_IDLE, idle);
+        if (task) {
+            run_task(task);
+        }
+    }
+    return NULL;
+}
+
+Pool *pool_create(int num_threads) {
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    Pool *pool = malloc(sizeof(Pool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->workers = aligned_alloc(CACHE_LINE, num_threads * sizeof(Worker));
+    if (!pool->workers) {
+        free(pool);
+        return NULL;
+    }
+    memset(pool->workers, 0, num_threads * sizeof(Worker));
+    pool->num_workers = num_threads;
+    atomic_init(&pool->stop, 0);
+    atomic_init(&pool->sleeping, 0);
+    atomic_init(&pool->generation, 0);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    for (int i = 0; i < num_threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].rng = 2654435761u * (i + 1);
+    }
+    // Нулевой рабочий - тот, кто вызовет pool_run, для него потока нет
+    for (int i = 1; i < num_threads; i++) {
+        if (pthread_create(&pool->workers[i].thread, NULL, worker_main, &pool->workers[i]) != 0) {
+            perror("pthread_create (pool worker) failed");
+            pool->num_workers = i;
+            break;
+        }
+    }
+    return pool;
+}
+
+void pool_destroy(Pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    atomic_store(&pool->stop, 1);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 1; i < pool->num_workers; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    free(pool->workers);
+    free(pool);
+}
+
+int pool_size(const Pool *pool) {
+    return pool->num_workers;
+}
+
+void pool_run(Pool *pool, task_fn fn, void *arg) {
+    Worker *saved = current_worker;
+    current_worker = &pool->workers[0];
+    fn(arg);
+    current_worker = saved;
+}
+
+void pool_spawn(Task *task, task_fn fn, void *arg) {
+    task->fn = fn;
+    task->arg = arg;
+    atomic_store_explicit(&task->done, 0, memory_order_relaxed);
+
+    Worker *self = current_worker;
+    if (!self || !deque_push(&self->deque, task)) {
+        run_task(task);
+        return;
+    }
+
+    Pool *pool = self->pool;
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&pool->sleeping, memory_order_relaxed) > 0) {
+        pthread_mutex_lock(&pool->lock);
+        atomic_fetch_add(&pool->generation, 1);
+        pthread_cond_signal(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+void pool_sync(Task *task) {
+    Worker *self = current_worker;
+    int idle = 0;
+    uint64_t wait = trace_begin();
+    while (!atomic_load_explicit(&task->done, memory_order_acquire)) {
+        // Пока задачу не украли, она лежит на дне своей деки; если украли -
+        // помогаем другим, а не простаиваем
+        Task *other = self ? find_work(self) : NULL;
+        if (other) {
+            // Выполнение чужой задачи - работа, а не ожидание
+            trace_end(TRACE_JOIN, wait);
+            run_task(other);
+            wait = trace_begin();
+            idle = 0;
+        } else if (++idle > SPIN_ROUNDS) {
+            sched_yield();
+        }
+    }
+    trace_end(TRACE_JOIN, wait);
+}
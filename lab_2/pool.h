@@ -0,0 +1,37 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdatomic.h>
+
+// Пул потоков с перехватом работы (work stealing). У каждого потока своя
+// дека задач: владелец кладёт и снимает задачи с одного конца, свободные
+// потоки забирают самые старые (крупные) задачи с другого. Задачи
+// порождаются в стиле fork/join: pool_spawn + pool_sync в той же функции.
+
+typedef void (*task_fn)(void *arg);
+
+typedef struct {
+    task_fn fn;
+    void *arg;
+    atomic_int done;
+} Task;
+
+typedef struct Pool Pool;
+
+// num_threads - всего потоков, считая вызывающий pool_run
+Pool *pool_create(int num_threads);
+void pool_destroy(Pool *pool);
+// Сколько потоков реально запущено, считая вызывающий pool_run
+int pool_size(const Pool *pool);
+
+// Выполняет fn(arg) в вызывающем потоке как корневую задачу и
+// возвращается, когда она закончится вместе со всеми порождёнными
+void pool_run(Pool *pool, task_fn fn, void *arg);
+
+// Задача (обычно на стеке вызывающего) может быть выполнена другим
+// потоком; до pool_sync её и arg трогать нельзя. Вне пула - выполняется сразу
+void pool_spawn(Task *task, task_fn fn, void *arg);
+// Ждёт задачу, выполняя пока свою или чужую работу
+void pool_sync(Task *task);
+
+#endif
@@ -0,0 +1,124 @@
+#include "psort.h"
+#include <stdlib.h>
+#include <string.h>
+#include "psort_template.h"
+
+#define PSORT_INSERTION 24      // Меньшие участки сортируются вставками
+
+typedef struct {
+    int64_t key;
+    size_t index;
+} KeyIndex;
+
+// Без пула корневая задача выполняется в вызывающем потоке,
+// pool_spawn вне пула тоже выполняет задачи сразу
+static void run_root(Pool *pool, task_fn fn, void *arg) {
+    if (pool) {
+        pool_run(pool, fn, arg);
+    } else {
+        fn(arg);
+    }
+}
+
+// Движок из psort_template.h на вставках и простом слиянии, сравнение
+// встроено в цикл: без вызова функции на сравнение, как у qsort.
+// NAME##_sort выделяет буфер на время сортировки
+#define DEFINE_TYPED_PSORT(NAME, T, LESS)                                        \
+                                                                                 \
+DEFINE_PSORT_KERNELS(NAME, T, LESS)                                              \
+DEFINE_PSORT(NAME, T, LESS, PSORT_INSERTION, NAME##_insertion, NAME##_merge)     \
+                                                                                 \
+static int NAME##_sort(Pool *pool, T *data, size_t n) {                          \
+    if (n < 2) {                                                                 \
+        return 0;                                                                \
+    }                                                                            \
+    T *buffer = malloc(n * sizeof(T));                                           \
+    if (!buffer) {                                                               \
+        return -1;                                                               \
+    }                                                                            \
+    NAME##_SortArgs args = { data, buffer, n, 0 };                               \
+    run_root(pool, NAME##_pool_sort, &args);                                     \
+    free(buffer);                                                                \
+    return 0;                                                                    \
+}
+
+#define LESS_STRING(x, y) (strcmp((x), (y)) < 0)
+#define LESS_KEY(x, y) ((x).key < (y).key)
+
+DEFINE_TYPED_PSORT(int32, int32_t, LESS_VALUE)
+DEFINE_TYPED_PSORT(int64, int64_t, LESS_VALUE)
+DEFINE_TYPED_PSORT(string, const char *, LESS_STRING)
+DEFINE_TYPED_PSORT(keyindex, KeyIndex, LESS_KEY)
+
+int psort_int32(Pool *pool, int32_t *data, size_t n) {
+    return int32_sort(pool, data, n);
+}
+
+int psort_int64(Pool *pool, int64_t *data, size_t n) {
+    return int64_sort(pool, data, n);
+}
+
+int psort_strings(Pool *pool, const char **data, size_t n) {
+    return string_sort(pool, data, n);
+}
+
+// Номера идут по возрастанию, а сортировка устойчива - поэтому записи
+// с равными ключами остаются в исходном порядке
+int psort_order(Pool *pool, const void *data, size_t n, size_t size,
+                psort_key_fn key, size_t *order) {
+    KeyIndex *pairs = malloc((n ? n : 1) * sizeof(KeyIndex));
+    if (!pairs) {
+        return -1;
+    }
+    const char *record = data;
+    for (size_t i = 0; i < n; i++) {
+        pairs[i].key = key(record + i * size);
+        pairs[i].index = i;
+    }
+    if (keyindex_sort(pool, pairs, n) != 0) {
+        free(pairs);
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        order[i] = pairs[i].index;
+    }
+    free(pairs);
+    return 0;
+}
+
+// Перестановка на месте по циклам: на место i встаёт запись order[i],
+// освободившееся место занимает следующая в цикле. Каждая запись
+// копируется один раз, плюс одна копия на цикл во временную память
+int psort_records(Pool *pool, void *data, size_t n, size_t size, psort_key_fn key) {
+    if (n < 2 || size == 0) {
+        return 0;
+    }
+    size_t *order = malloc(n * sizeof(size_t));
+    char *saved = malloc(size);
+    if (!order || !saved || psort_order(pool, data, n, size, key, order) != 0) {
+        free(order);
+        free(saved);
+        return -1;
+    }
+
+    char *records = data;
+    for (size_t i = 0; i < n; i++) {
+        if (order[i] == i) {
+            continue;
+        }
+        memcpy(saved, records + i * size, size);
+        size_t j = i;
+        while (order[j] != i) {
+            size_t next = order[j];
+            memcpy(records + j * size, records + next * size, size);
+            order[j] = j;
+            j = next;
+        }
+        memcpy(records + j * size, saved, size);
+        order[j] = j;
+    }
+
+    free(order);
+    free(saved);
+    return 0;
+}
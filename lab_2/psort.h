@@ -0,0 +1,30 @@
+#ifndef PSORT_H
+#define PSORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pool.h"
+
+// Устойчивая параллельная сортировка слиянием на пуле с перехватом
+// работы - тот же движок psort_template.h, что и в sort.c (буфер-пара,
+// слияние по co-rank), но для нескольких типов. Каждый тип - отдельная
+// копия кода со своим сравнением, встроенным в цикл: без вызова функции
+// на сравнение, как у qsort. pool == NULL - сортировка в вызывающем
+// потоке. Все функции возвращают 0 или -1, если не хватило памяти.
+
+int psort_int32(Pool *pool, int32_t *data, size_t n);
+int psort_int64(Pool *pool, int64_t *data, size_t n);
+// Порядок strcmp; переставляются только указатели
+int psort_strings(Pool *pool, const char **data, size_t n);
+
+// Записи произвольного размера с ключом int64. Ключ извлекается один раз
+// на запись, сортируются пары (ключ, номер), а сами записи переносятся
+// одним проходом в конце - по разу каждая, без буфера размером с массив
+typedef int64_t (*psort_key_fn)(const void *record);
+int psort_records(Pool *pool, void *data, size_t n, size_t size, psort_key_fn key);
+
+// То же без переноса: order[i] - номер записи, стоящей i-й по порядку
+int psort_order(Pool *pool, const void *data, size_t n, size_t size,
+                psort_key_fn key, size_t *order);
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef PSORT_TEMPLATE_H
+#define PSORT_TEMPLATE_H
+
+#include <string.h>
+#include "pool.h"
+#include "trace.h"
+
+// Единственный движок сортировки слиянием: sort.c разворачивает его для
+// int на векторных ядрах, psort.c - для своих типов на вставках.
+//
+// Слияние идёт между массивом и буфером того же размера попеременно:
+// половины кладут результат туда, откуда родитель будет сливать,
+// поэтому обратного копирования и выделений памяти внутри сортировки нет.
+// Равные элементы сохраняют порядок: слияние и co-rank при равенстве
+// берут левый участок, вставки не двигают равные
+
+// Меньшие участки сортируются последовательно: задача дешевле
+// сортировки 8К элементов уже не окупает перехват
+#define PSORT_GRAIN 8192
+
+#define LESS_VALUE(x, y) ((x) < (y))
+
+// Ядра по умолчанию для типа T с предикатом LESS(x, y) - "x строго
+// меньше y": вставки для коротких участков и простое слияние
+#define DEFINE_PSORT_KERNELS(NAME, T, LESS)                                      \
+                                                                                 \
+static void NAME##_insertion(T *array, size_t n) {                               \
+    for (size_t i = 1; i < n; i++) {                                             \
+        T value = array[i];                                                      \
+        size_t j = i;                                                            \
+        while (j > 0 && LESS(value, array[j - 1])) {                             \
+            array[j] = array[j - 1];                                             \
+            j--;                                                                 \
+        }                                                                        \
+        array[j] = value;                                                        \
+    }                                                                            \
+}                                                                                \
+                                                                                 \
+static void NAME##_merge(const T *a, size_t na, const T *b, size_t nb, T *dst) { \
+    size_t i = 0, j = 0, k = 0;                                                  \
+    while (i < na && j < nb) {                                                   \
+        if (LESS(b[j], a[i])) {                                                  \
+            dst[k++] = b[j++];                                                   \
+        } else {                                                                 \
+            dst[k++] = a[i++];                                                   \
+        }                                                                        \
+    }                                                                            \
+    while (i < na) {                                                             \
+        dst[k++] = a[i++];                                                       \
+    }                                                                            \
+    while (j < nb) {                                                             \
+        dst[k++] = b[j++];                                                       \
+    }                                                                            \
+}
+
+// Параллельное слияние для типа T: MERGE_RUNS(a, na, b, nb, dst) сливает
+// два отсортированных куска устойчиво. NAME##_pool_merge - задача пула
+// над NAME##_MergeArgs: слияния крупнее PSORT_GRAIN делятся по середине
+// выхода на независимые куски.
+//   co_rank - сколько элементов a попадёт в первые k элементов слияния
+//     (merge path): бинарный поиск по диагонали k, равные элементы a
+//     относятся к куску раньше равных из b, так что куски сливаются
+//     независимо;
+//   split_merge - деление слияния по середине выхода на два независимых;
+//   merge_step - последний, неделимый кусок параллельного слияния.
+// Без DEFINE_PSORT нужно natural.c, у которого своё ядро слияния
+#define DEFINE_PSORT_MERGE(NAME, T, LESS, MERGE_RUNS)                            \
+                                                                                 \
+typedef struct {                                                                 \
+    const T *a;                                                                  \
+    size_t na;                                                                   \
+    const T *b;                                                                  \
+    size_t nb;                                                                   \
+    T *dst;                                                                      \
+} NAME##_MergeArgs;                                                              \
+                                                                                 \
+static void NAME##_merge_runs(const T *a, size_t na, const T *b, size_t nb,      \
+                              T *dst) {                                          \
+    trace_count(TRACE_MERGE_CALLS);                                              \
+    MERGE_RUNS(a, na, b, nb, dst);                                               \
+}                                                                                \
+                                                                                 \
+static size_t NAME##_co_rank(size_t k, const T *a, size_t na,                    \
+                             const T *b, size_t nb) {                            \
+    size_t lo = k > nb ? k - nb : 0;                                             \
+    size_t hi = k < na ? k : na;                                                 \
+    while (lo < hi) {                                                            \
+        size_t i = lo + (hi - lo) / 2;                                           \
+        if (!LESS(b[k - i - 1], a[i])) {                                         \
+            lo = i + 1;                                                          \
+        } else {                                                                 \
+            hi = i;                                                              \
+        }                                                                        \
+    }                                                                            \
+    return lo;                                                                   \
+}                                                                                \
+                                                                                 \
+static void NAME##_split_merge(const NAME##_MergeArgs *m, NAME##_MergeArgs *left,\
+                               NAME##_MergeArgs *right) {                        \
+    size_t k = (m->na + m->nb) / 2;                                              \
+    size_t i = NAME##_co_rank(k, m->a, m->na, m->b, m->nb);                      \
+    *left = (NAME##_MergeArgs){ m->a, i, m->b, k - i, m->dst };                  \
+    *right = (NAME##_MergeArgs){ m->a + i, m->na - i, m->b + (k - i),            \
+                                 m->nb - (k - i), m->dst + k };                  \
+}                                                                                \
+                                                                                 \
+static void NAME##_merge_step(const NAME##_MergeArgs *m) {                       \
+    uint64_t start = trace_begin();                                              \
+    NAME##_merge_runs(m->a, m->na, m->b, m->nb, m->dst);                         \
+    trace_end(TRACE_MERGE, start);                                               \
+}                                                                                \
+                                                                                 \
+static void NAME##_pool_merge(void *args) {                                      \
+    NAME##_MergeArgs *m = (NAME##_MergeArgs *)args;                              \
+    if (m->na + m->nb <= PSORT_GRAIN) {                                          \
+        NAME##_merge_step(m);                                                    \
+        return;                                                                  \
+    }                                                                            \
+    NAME##_MergeArgs left, right;                                                \
+    NAME##_split_merge(m, &left, &right);                                        \
+    Task leftTask;                                                               \
+    pool_spawn(&leftTask, NAME##_pool_merge, &left);                             \
+    NAME##_pool_merge(&right);                                                   \
+    pool_sync(&leftTask);                                                        \
+}
+
+// Сортировка для типа T: участки не длиннее BLOCK_SIZE сортирует
+// SORT_BLOCK(array, n), два отсортированных куска сливает
+// MERGE_RUNS(a, na, b, nb, dst). Оба должны быть устойчивыми.
+//
+// NAME##_SortArgs - участок array[0..n) и буфер, to_buffer - где нужен
+// результат. NAME##_pool_sort - корневая задача для pool_run: fork/join,
+// левая половина отдаётся в деку, правую сортирует текущий поток.
+// Режиму spawn в sort.c, который делит работу потоками, нужны ещё
+// функции слияния из DEFINE_PSORT_MERGE и
+//   base_case - участок, который поток сортирует сам целиком;
+//   halves - половины участка там, где их оставила сортировка уровнем ниже
+#define DEFINE_PSORT(NAME, T, LESS, BLOCK_SIZE, SORT_BLOCK, MERGE_RUNS)          \
+                                                                                 \
+DEFINE_PSORT_MERGE(NAME, T, LESS, MERGE_RUNS)                                    \
+                                                                                 \
+typedef struct {                                                                 \
+    T *array;                                                                    \
+    T *buffer;                                                                   \
+    size_t n;                                                                    \
+    int to_buffer;                                                               \
+} NAME##_SortArgs;                                                               \
+                                                                                 \
+static void NAME##_sort_range(T *array, T *buffer, size_t n, int to_buffer) {    \
+    if (n <= (BLOCK_SIZE)) {                                                     \
+        if (to_buffer) {                                                         \
+            memcpy(buffer, array, n * sizeof(T));                                \
+        }                                                                        \
+        SORT_BLOCK(to_buffer ? buffer : array, n);                               \
+        return;                                                                  \
+    }                                                                            \
+    size_t mid = n / 2;                                                          \
+    NAME##_sort_range(array, buffer, mid, !to_buffer);                           \
+    NAME##_sort_range(array + mid, buffer + mid, n - mid, !to_buffer);           \
+    if (to_buffer) {                                                             \
+        NAME##_merge_runs(array, mid, array + mid, n - mid, buffer);             \
+    } else {                                                                     \
+        NAME##_merge_runs(buffer, mid, buffer + mid, n - mid, array);            \
+    }                                                                            \
+}                                                                                \
+                                                                                 \
+static void NAME##_base_case(T *array, T *buffer, size_t n, int to_buffer) {     \
+    uint64_t start = trace_begin();                                              \
+    NAME##_sort_range(array, buffer, n, to_buffer);                              \
+    trace_end(TRACE_BASE, start);                                                \
+}                                                                                \
+                                                                                 \
+static NAME##_MergeArgs NAME##_halves(const NAME##_SortArgs *s, size_t mid) {    \
+    const T *src = s->to_buffer ? s->array : s->buffer;                          \
+    T *dst = s->to_buffer ? s->buffer : s->array;                                \
+    return (NAME##_MergeArgs){ src, mid, src + mid, s->n - mid, dst };           \
+}                                                                                \
+                                                                                 \
+static void NAME##_pool_sort(void *args) {                                       \
+    trace_count(TRACE_SORT_CALLS);                                               \
+    NAME##_SortArgs *s = (NAME##_SortArgs *)args;                                \
+    if (s->n <= PSORT_GRAIN) {                                                   \
+        NAME##_base_case(s->array, s->buffer, s->n, s->to_buffer);               \
+        return;                                                                  \
+    }                                                                            \
+    size_t mid = s->n / 2;                                                       \
+    NAME##_SortArgs left = { s->array, s->buffer, mid, !s->to_buffer };          \
+    NAME##_SortArgs right = { s->array + mid, s->buffer + mid, s->n - mid,       \
+                              !s->to_buffer };                                   \
+    Task leftTask;                                                               \
+    pool_spawn(&leftTask, NAME##_pool_sort, &left);                              \
+    NAME##_pool_sort(&right);                                                    \
+    pool_sync(&leftTask);                                                        \
+    NAME##_MergeArgs merge = NAME##_halves(s, mid);                              \
+    NAME##_pool_merge(&merge);                                                   \
+}
+
+#endif
@@ -0,0 +1,211 @@
+#include "radix.h"
+#include <emmintrin.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIGITS 4            // Байтов в ключе
+#define BUCKETS 256
+#define WC_SIZE 16          // int в буфере записи - одна строка кэша
+#define MIN_PART 65536      // Меньшие части не окупают задачу пула
+
+typedef size_t Histogram[BUCKETS];
+
+typedef struct {
+    const int *src;
+    int *dst;
+    size_t n;
+    int parts;
+    int digit;
+    Histogram *counts;              // [part]: счётчики, затем позиции записи
+    Histogram (*first)[DIGITS];     // [part][digit]: все байты за одно чтение
+} RadixSort;
+
+typedef void (*part_fn)(RadixSort *rs, int part);
+
+typedef struct {
+    RadixSort *rs;
+    part_fn fn;
+    int lo;
+    int hi;
+} PartRange;
+
+// Знаковый бит инвертируется, чтобы отрицательные шли раньше
+static inline unsigned digit_of(int value, int digit) {
+    return (((unsigned)value ^ 0x80000000u) >> (digit * 8)) & (BUCKETS - 1);
+}
+
+static inline size_t part_start(const RadixSort *rs, int part) {
+    size_t base = rs->n / rs->parts, extra = rs->n % rs->parts;
+    return base * part + ((size_t)part < extra ? (size_t)part : extra);
+}
+
+// Части раздаются пулу делением пополам, как и слияние
+static void run_parts(void *arg) {
+    PartRange *range = (PartRange *)arg;
+    if (range->hi - range->lo == 1) {
+        range->fn(range->rs, range->lo);
+        return;
+    }
+    int mid = (range->lo + range->hi) / 2;
+    PartRange left = { range->rs, range->fn, range->lo, mid };
+    PartRange right = { range->rs, range->fn, mid, range->hi };
+
+    Task leftTask;
+    pool_spawn(&leftTask, run_parts, &left);
+    run_parts(&right);
+    pool_sync(&leftTask);
+}
+
+static void for_each_part(RadixSort *rs, part_fn fn) {
+    PartRange range = { rs, fn, 0, rs->parts };
+    run_parts(&range);
+}
+
+static void count_all_digits(RadixSort *rs, int part) {
+    Histogram *counts = rs->first[part];
+    memset(counts, 0, sizeof(Histogram) * DIGITS);
+    for (size_t i = part_start(rs, part), end = part_start(rs, part + 1); i < end; i++) {
+        int value = rs->src[i];
+        for (int d = 0; d < DIGITS; d++) {
+            counts[d][digit_of(value, d)]++;
+        }
+    }
+}
+
+static void count_digit(RadixSort *rs, int part) {
+    size_t *counts = rs->counts[part];
+    memset(counts, 0, sizeof(Histogram));
+    for (size_t i = part_start(rs, part), end = part_start(rs, part + 1); i < end; i++) {
+        counts[digit_of(rs->src[i], rs->digit)]++;
+    }
+}
+
+// Полная строка уходит в память потоковой записью мимо кэша: она не
+// вытесняет исходные данные и не читается перед записью
+static inline void stream_line(int *dst, const int *line) {
+    for (int k = 0; k < WC_SIZE; k += 4) {
+        _mm_stream_si128((__m128i *)(dst + k), _mm_load_si128((const __m128i *)(line + k)));
+    }
+}
+
+// Элементы копятся по корзинам в буферах размером в строку кэша и
+// уходят в массив целой строкой: запись в 256 разных мест подряд
+// иначе промахивается и по кэшу, и по TLB на каждом элементе.
+// Буфер повторяет раскладку строки dst, поэтому место элемента в нём
+// определяется его позицией. Крайние строки участка корзины делят
+// с соседями, их элементы пишутся обычным копированием
+static void scatter(RadixSort *rs, int part) {
+    _Alignas(64) int wc[BUCKETS][WC_SIZE];
+    size_t begin[BUCKETS];
+    size_t *pos = rs->counts[part];
+    int *dst = rs->dst;
+    size_t shift = (uintptr_t)dst % 64 / sizeof(int);
+    memcpy(begin, pos, sizeof(begin));
+
+    for (size_t i = part_start(rs, part), end = part_start(rs, part + 1); i < end; i++) {
+        int value = rs->src[i];
+        unsigned b = digit_of(value, rs->digit);
+        size_t q = pos[b]++;
+        size_t slot = (q + shift) & (WC_SIZE - 1);
+        wc[b][slot] = value;
+        if (slot == WC_SIZE - 1) {
+            if (q + 1 >= begin[b] + WC_SIZE) {
+                stream_line(dst + q + 1 - WC_SIZE, wc[b]);
+            } else {
+                memcpy(dst + begin[b], &wc[b][(begin[b] + shift) & (WC_SIZE - 1)],
+                       (q + 1 - begin[b]) * sizeof(int));
+            }
+        }
+    }
+    for (int b = 0; b < BUCKETS; b++) {
+        size_t filled = (pos[b] + shift) & (WC_SIZE - 1);
+        if (pos[b] == begin[b] || filled == 0) {
+            continue;
+        }
+        size_t from = pos[b] - begin[b] < filled ? begin[b] : pos[b] - filled;
+        memcpy(dst + from, &wc[b][(from + shift) & (WC_SIZE - 1)], (pos[b] - from) * sizeof(int));
+    }
+    // Потоковые записи не упорядочены release-семантикой pool_sync
+    _mm_sfence();
+}
+
+// Позиция корзины b части p: все меньшие корзины, затем та же корзина
+// предыдущих частей - так раскладка устойчива
+static void prefix_sums(RadixSort *rs) {
+    size_t offset = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+        for (int p = 0; p < rs->parts; p++) {
+            size_t count = rs->counts[p][b];
+            rs->counts[p][b] = offset;
+            offset += count;
+        }
+    }
+}
+
+static void radix_root(void *arg) {
+    RadixSort *rs = (RadixSort *)arg;
+    int *array = (int *)rs->src;
+    int *buffer = rs->dst;
+
+    for_each_part(rs, count_all_digits);
+
+    int first_pass = 1;
+    for (int d = 0; d < DIGITS; d++) {
+        // Байт, одинаковый у всех ключей, порядок не меняет
+        size_t largest = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            size_t total = 0;
+            for (int p = 0; p < rs->parts; p++) {
+                total += rs->first[p][d][b];
+            }
+            largest = total > largest ? total : largest;
+        }
+        if (largest == rs->n) {
+            continue;
+        }
+
+        rs->digit = d;
+        if (first_pass) {
+            // Части ещё не переставлены - годится подсчёт первого чтения
+            for (int p = 0; p < rs->parts; p++) {
+                memcpy(rs->counts[p], rs->first[p][d], sizeof(Histogram));
+            }
+            first_pass = 0;
+        } else {
+            for_each_part(rs, count_digit);
+        }
+        prefix_sums(rs);
+        for_each_part(rs, scatter);
+
+        int *tmp = (int *)rs->src;
+        rs->src = rs->dst;
+        rs->dst = tmp;
+    }
+
+    if (rs->src != array) {
+        memcpy(array, buffer, rs->n * sizeof(int));
+    }
+}
+
+void radix_sort(Pool *pool, int *array, int *buffer, size_t n) {
+    if (n < 2) {
+        return;
+    }
+    int parts = pool_size(pool);
+    if ((size_t)parts > n / MIN_PART) {
+        parts = n / MIN_PART > 0 ? (int)(n / MIN_PART) : 1;
+    }
+
+    RadixSort rs = { array, buffer, n, parts, 0, NULL, NULL };
+    rs.counts = malloc(parts * sizeof(Histogram));
+    rs.first = malloc(parts * sizeof(*rs.first));
+    if (!rs.counts || !rs.first) {
+        perror("malloc for radix counts");
+        exit(EXIT_FAILURE);
+    }
+    pool_run(pool, radix_root, &rs);
+    free(rs.counts);
+    free(rs.first);
+}
@@ -0,0 +1,14 @@
+#ifndef RADIX_H
+#define RADIX_H
+
+#include <stddef.h>
+#include "pool.h"
+
+// Поразрядная сортировка LSD для int по байтам: каждый проход - подсчёт
+// гистограмм по частям массива в потоках пула, префиксные суммы и
+// устойчивая раскладка каждой части в свои позиции. Проходы по байту,
+// одинаковому у всех ключей, пропускаются.
+// buffer - рабочая память на n элементов, результат всегда в array
+void radix_sort(Pool *pool, int *array, int *buffer, size_t n);
+
+#endif
@@ -0,0 +1,323 @@
+#include "simd_sort.h"
+#include <immintrin.h>
+#include <limits.h>
+#include <string.h>
+
+// Векторные функции собираются с атрибутом target, поэтому весь файл
+// компилируется без -mavx2/-mavx512f и работает на любом x86-64;
+// вызываются они только после проверки CPUID в simd_select
+
+#define AVX2 __attribute__((target("avx2")))
+#define AVX512 __attribute__((target("avx512f")))
+
+#define SCALAR_BLOCK 32     // Вставками быстрее слияния на коротких участках
+#define AVX2_BLOCK 64       // 8 регистров по 8 int
+#define AVX512_BLOCK 128    // 8 регистров по 16 int
+#define MAX_BLOCK AVX512_BLOCK
+
+typedef void (*sort_chunk_fn)(int *chunk);
+typedef void (*merge_fn)(const int *a, size_t na, const int *b, size_t nb, int *dst);
+
+// ---------- Скалярный вариант ----------
+
+static void scalar_merge(const int *a, size_t na, const int *b, size_t nb, int *dst) {
+    size_t i = 0, j = 0, k = 0;
+    // Выбор без ветвления: исход сравнения случаен и плохо предсказуем
+    while (i < na && j < nb) {
+        int take_left = a[i] <= b[j];
+        dst[k++] = take_left ? a[i] : b[j];
+        i += take_left;
+        j += !take_left;
+    }
+    while (i < na) {
+        dst[k++] = a[i++];
+    }
+    while (j < nb) {
+        dst[k++] = b[j++];
+    }
+}
+
+static void scalar_sort_block(int *array, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        int value = array[i];
+        size_t j = i;
+        while (j > 0 && array[j - 1] > value) {
+            array[j] = array[j - 1];
+            j--;
+        }
+        array[j] = value;
+    }
+}
+
+// Досливает остаток векторного слияния: регистр tail (он не меньше
+// всего уже записанного) и хвосты обоих участков
+static void merge_tail(const int *tail, size_t width,
+                       const int *a, size_t na, const int *b, size_t nb, int *dst) {
+    size_t t = 0, i = 0, j = 0;
+    while (t < width) {
+        int value = tail[t];
+        if (i < na && a[i] < value && (j >= nb || a[i] <= b[j])) {
+            *dst++ = a[i++];
+        } else if (j < nb && b[j] < value) {
+            *dst++ = b[j++];
+        } else {
+            *dst++ = tail[t++];
+        }
+    }
+    scalar_merge(a + i, na - i, b + j, nb - j, dst);
+}
+
+// Блок дополняется INT_MAX до целого числа регистров, каждый регистр
+// сортируется сетью, затем серии сливаются попарно между двумя буферами
+static void sort_block_with(int *array, size_t n, size_t width,
+                            sort_chunk_fn sort_chunk, merge_fn merge) {
+    int tmp[2][MAX_BLOCK];
+    size_t padded = (n + width - 1) / width * width;
+    memcpy(tmp[0], array, n * sizeof(int));
+    for (size_t i = n; i < padded; i++) {
+        tmp[0][i] = INT_MAX;
+    }
+    for (size_t c = 0; c < padded; c += width) {
+        sort_chunk(tmp[0] + c);
+    }
+
+    int src = 0;
+    for (size_t run = width; run < padded; run *= 2) {
+        for (size_t lo = 0; lo < padded; lo += 2 * run) {
+            size_t mid = lo + run < padded ? lo + run : padded;
+            size_t hi = lo + 2 * run < padded ? lo + 2 * run : padded;
+            merge(tmp[src] + lo, mid - lo, tmp[src] + mid, hi - mid, tmp[!src] + lo);
+        }
+        src = !src;
+    }
+    memcpy(array, tmp[src], n * sizeof(int));
+}
+
+// ---------- AVX2: 8 int в регистре ----------
+
+// Шаг битонной сети: лана i сравнивается с i ^ j; в блоке длины k
+// направление чередуется, при k больше регистра всё по возрастанию
+AVX2 static inline __m256i avx2_step(__m256i x, int j, int k) {
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i partner = _mm256_permutevar8x32_epi32(x, _mm256_xor_si256(lane, _mm256_set1_epi32(j)));
+    __m256i lo = _mm256_min_epi32(x, partner);
+    __m256i hi = _mm256_max_epi32(x, partner);
+    __m256i lower = _mm256_cmpeq_epi32(_mm256_and_si256(lane, _mm256_set1_epi32(j)), zero);
+    __m256i ascending = _mm256_cmpeq_epi32(_mm256_and_si256(lane, _mm256_set1_epi32(k)), zero);
+    return _mm256_blendv_epi8(lo, hi, _mm256_xor_si256(lower, ascending));
+}
+
+AVX2 static inline __m256i avx2_sort8(__m256i x) {
+    for (int k = 2; k <= 8; k *= 2) {
+        for (int j = k / 2; j > 0; j /= 2) {
+            x = avx2_step(x, j, k);
+        }
+    }
+    return x;
+}
+
+// Два отсортированных регистра -> 16 отсортированных в (lo, hi)
+AVX2 static inline void avx2_merge16(__m256i a, __m256i b, __m256i *lo, __m256i *hi) {
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    b = _mm256_permutevar8x32_epi32(b, reverse);
+    __m256i l = _mm256_min_epi32(a, b);
+    __m256i h = _mm256_max_epi32(a, b);
+    for (int j = 4; j > 0; j /= 2) {
+        l = avx2_step(l, j, 16);
+        h = avx2_step(h, j, 16);
+    }
+    *lo = l;
+    *hi = h;
+}
+
+AVX2 static void avx2_sort_chunk(int *chunk) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)chunk);
+    _mm256_storeu_si256((__m256i *)chunk, avx2_sort8(x));
+}
+
+// Слияние по регистру за шаг: в hi остаются 8 наибольших из уже
+// прочитанных, следующий регистр берётся из участка с меньшей головой
+AVX2 static void avx2_merge(const int *a, size_t na, const int *b, size_t nb, int *dst) {
+    if (na < 8 || nb < 8) {
+        scalar_merge(a, na, b, nb, dst);
+        return;
+    }
+    __m256i next = _mm256_loadu_si256((const __m256i *)a);
+    __m256i lo, hi = _mm256_loadu_si256((const __m256i *)b);
+    size_t i = 8, j = 8;
+    for (;;) {
+        avx2_merge16(next, hi, &lo, &hi);
+        _mm256_storeu_si256((__m256i *)dst, lo);
+        dst += 8;
+        if (i < na && (j >= nb || a[i] <= b[j])) {
+            if (na - i < 8) {
+                break;
+            }
+            next = _mm256_loadu_si256((const __m256i *)(a + i));
+            i += 8;
+        } else if (j < nb) {
+            if (nb - j < 8) {
+                break;
+            }
+            next = _mm256_loadu_si256((const __m256i *)(b + j));
+            j += 8;
+        } else {
+            break;
+        }
+    }
+    int tail[8];
+    _mm256_storeu_si256((__m256i *)tail, hi);
+    merge_tail(tail, 8, a + i, na - i, b + j, nb - j, dst);
+}
+
+static void avx2_sort_block(int *array, size_t n) {
+    sort_block_with(array, n, 8, avx2_sort_chunk, avx2_merge);
+}
+
+// ---------- AVX-512: 16 int в регистре ----------
+
+AVX512 static inline __m512i avx512_step(__m512i x, int j, int k) {
+    const __m512i lane = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7,
+                                           8, 9, 10, 11, 12, 13, 14, 15);
+    __m512i partner = _mm512_permutexvar_epi32(_mm512_xor_si512(lane, _mm512_set1_epi32(j)), x);
+    __m512i lo = _mm512_min_epi32(x, partner);
+    __m512i hi = _mm512_max_epi32(x, partner);
+    __mmask16 lower = _mm512_testn_epi32_mask(lane, _mm512_set1_epi32(j));
+    __mmask16 ascending = _mm512_testn_epi32_mask(lane, _mm512_set1_epi32(k));
+    return _mm512_mask_blend_epi32(lower ^ ascending, lo, hi);
+}
+
+AVX512 static inline __m512i avx512_sort16(__m512i x) {
+    for (int k = 2; k <= 16; k *= 2) {
+        for (int j = k / 2; j > 0; j /= 2) {
+            x = avx512_step(x, j, k);
+        }
+    }
+    return x;
+}
+
+AVX512 static inline void avx512_merge32(__m512i a, __m512i b, __m512i *lo, __m512i *hi) {
+    const __m512i reverse = _mm512_setr_epi32(15, 14, 13, 12, 11, 10, 9, 8,
+                                              7, 6, 5, 4, 3, 2, 1, 0);
+    b = _mm512_permutexvar_epi32(reverse, b);
+    __m512i l = _mm512_min_epi32(a, b);
+    __m512i h = _mm512_max_epi32(a, b);
+    for (int j = 8; j > 0; j /= 2) {
+        l = avx512_step(l, j, 32);
+        h = avx512_step(h, j, 32);
+    }
+    *lo = l;
+    *hi = h;
+}
+
+AVX512 static void avx512_sort_chunk(int *chunk) {
+    _mm512_storeu_si512(chunk, avx512_sort16(_mm512_loadu_si512(chunk)));
+}
+
+AVX512 static void avx512_merge(const int *a, size_t na, const int *b, size_t nb, int *dst) {
+    if (na < 16 || nb < 16) {
+        scalar_merge(a, na, b, nb, dst);
+        return;
+    }
+    __m512i next = _mm512_loadu_si512(a);
+    __m512i lo, hi = _mm512_loadu_si512(b);
+    size_t i = 16, j = 16;
+    for (;;) {
+        avx512_merge32(next, hi, &lo, &hi);
+        _mm512_storeu_si512(dst, lo);
+        dst += 16;
+        if (i < na && (j >= nb || a[i] <= b[j])) {
+            if (na - i < 16) {
+                break;
+            }
+            next = _mm512_loadu_si512(a + i);
+            i += 16;
+        } else if (j < nb) {
+            if (nb - j < 16) {
+                break;
+            }
+            next = _mm512_loadu_si512(b + j);
+            j += 16;
+        } else {
+            break;
+        }
+    }
+    int tail[16];
+    _mm512_storeu_si512(tail, hi);
+    merge_tail(tail, 16, a + i, na - i, b + j, nb - j, dst);
+}
+
+static void avx512_sort_block(int *array, size_t n) {
+    sort_block_with(array, n, 16, avx512_sort_chunk, avx512_merge);
+}
+
+// ---------- Выбор варианта ----------
+
+static SimdLevel current_level = SIMD_SCALAR;
+static size_t current_block = SCALAR_BLOCK;
+static void (*current_sort_block)(int *array, size_t n) = scalar_sort_block;
+static merge_fn current_merge = scalar_merge;
+
+SimdLevel simd_detect(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SIMD_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SIMD_AVX2;
+    }
+    return SIMD_SCALAR;
+}
+
+void simd_select(SimdLevel level) {
+    SimdLevel best = simd_detect();
+    if (level > best) {
+        level = best;
+    }
+    current_level = level;
+    switch (level) {
+    case SIMD_AVX512:
+        current_block = AVX512_BLOCK;
+        current_sort_block = avx512_sort_block;
+        current_merge = avx512_merge;
+        break;
+    case SIMD_AVX2:
+        current_block = AVX2_BLOCK;
+        current_sort_block = avx2_sort_block;
+        current_merge = avx2_merge;
+        break;
+    default:
+        current_block = SCALAR_BLOCK;
+        current_sort_block = scalar_sort_block;
+        current_merge = scalar_merge;
+        break;
+    }
+}
+
+SimdLevel simd_level(void) {
+    return current_level;
+}
+
+const char *simd_name(SimdLevel level) {
+    switch (level) {
+    case SIMD_AVX512:
+        return "avx512";
+    case SIMD_AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+size_t simd_block_size(void) {
+    return current_block;
+}
+
+void simd_sort_block(int *array, size_t n) {
+    current_sort_block(array, n);
+}
+
+void simd_merge(const int *a, size_t na, const int *b, size_t nb, int *dst) {
+    current_merge(a, na, b, nb, dst);
+}
@@ -0,0 +1,27 @@
+#ifndef SIMD_SORT_H
+#define SIMD_SORT_H
+
+#include <stddef.h>
+
+// Ядра сортировки int: блок сортируется целиком (сети сортировки в
+// регистрах), два отсортированных участка сливаются битонным слиянием
+// по вектору за шаг. Вариант выбирается во время работы по CPUID,
+// результат у всех вариантов одинаковый.
+
+typedef enum { SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512 } SimdLevel;
+
+// Лучший вариант, который поддерживает процессор
+SimdLevel simd_detect(void);
+// Переключает ядра; неподдерживаемый уровень понижается до доступного.
+// Вызывать до сортировки, не параллельно с ней
+void simd_select(SimdLevel level);
+SimdLevel simd_level(void);
+const char *simd_name(SimdLevel level);
+
+// Участки не длиннее этого сортируются одним simd_sort_block
+size_t simd_block_size(void);
+void simd_sort_block(int *array, size_t n);
+// Сливает a[0..na) и b[0..nb) в dst
+void simd_merge(const int *a, size_t na, const int *b, size_t nb, int *dst);
+
+#endif
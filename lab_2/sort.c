@@ -1,188 +1,576 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
-#include <sys/time.h>
 #include <pthread.h>
-#include <dispatch/dispatch.h>  // Для GCD-семафоров (macOS)
+#include <stdatomic.h>
+#include "pool.h"
+#include "simd_sort.h"
+#include "extsort.h"
+#include "radix.h"
+#include "natural.h"
+#include "trace.h"
+#include "psort_template.h"
+
+// Движок из psort_template.h на векторных ядрах, выбранных simd_select
+DEFINE_PSORT(int, int, LESS_VALUE, simd_block_size(), simd_sort_block, simd_merge)
+
+// Разрешения на создание потока в режиме spawn. Вместо семафора GCD -
+// счётчик: попытка взять разрешение не блокирует и не уходит в ядро
+static atomic_int thread_tokens = 0;
+
+static int try_acquire_token(void) {
+    int tokens = atomic_load_explicit(&thread_tokens, memory_order_relaxed);
+    while (tokens > 0) {
+        if (atomic_compare_exchange_weak_explicit(&thread_tokens, &tokens, tokens - 1,
+                                                  memory_order_acquire,
+                                                  memory_order_relaxed)) {
+            return 1;
+        }
+    }
+    return 0;
+}
 
-typedef struct {
-    int *array;
-    int left;
-    int right;
-} ThreadArgs;
+static void release_token(void) {
+    atomic_fetch_add_explicit(&thread_tokens, 1, memory_order_release);
+}
 
-static int merge_calls = 0;      
-static int sort_calls = 0;       
-static int threads_created = 0;  
 
-static dispatch_semaphore_t gcd_sem = NULL;
+static void join_thread(pthread_t thread) {
+    uint64_t start = trace_begin();
+    pthread_join(thread, NULL);
+    trace_end(TRACE_JOIN, start);
+}
 
+// int_pool_merge для режима spawn: к слиянию дочерние потоки уже завершились и
+// вернули разрешения, так что верхние слияния снова занимают все ядра
+static void *threaded_merge(void *args) {
+    int_MergeArgs *mergeArgs = (int_MergeArgs *)args;
+    if (mergeArgs->na + mergeArgs->nb <= PSORT_GRAIN || !try_acquire_token()) {
+        int_merge_step(mergeArgs);
+        return NULL;
+    }
 
-void merge(int *array, int l, int m, int r) {
-    __sync_fetch_and_add(&merge_calls, 1);
+    int_MergeArgs leftArgs, rightArgs;
+    int_split_merge(mergeArgs, &leftArgs, &rightArgs);
 
-    int n1 = m - l + 1;
-    int n2 = r - m;
-    int *L = (int *)malloc(n1 * sizeof(int));
-    int *R = (int *)malloc(n2 * sizeof(int));
-    if (!L || !R) {
-        perror("malloc for merge");
+    pthread_t leftThread;
+    if (pthread_create(&leftThread, NULL, threaded_merge, &leftArgs) != 0) {
+        perror("pthread_create (merge) failed");
+        release_token();
+        threaded_merge(&leftArgs);
+        threaded_merge(&rightArgs);
+        return NULL;
+    }
+    trace_count(TRACE_THREADS_CREATED);
+    threaded_merge(&rightArgs);
+    join_thread(leftThread);
+    release_token();
+    return NULL;
+}
+
+// Эталонная последовательная сортировка; буфер выделяется один раз
+void seq_merge_sort(int *array, size_t left, size_t right) {
+    if (left >= right) {
+        return;
+    }
+    size_t n = right - left + 1;
+    int *buffer = (int *)malloc(n * sizeof(int));
+    if (!buffer) {
+        perror("malloc for merge buffer");
         exit(EXIT_FAILURE);
     }
+    int_base_case(array + left, buffer, n, 0);
+    free(buffer);
+}
+
+void *threaded_mergesort(void *args) {
+    trace_count(TRACE_SORT_CALLS);
+
+    int_SortArgs *threadArgs = (int_SortArgs *)args;
+    int *array = threadArgs->array;
+    int *buffer = threadArgs->buffer;
+    size_t n = threadArgs->n;
+    int to_buffer = threadArgs->to_buffer;
 
-    for (int i = 0; i < n1; i++) {
-        L[i] = array[l + i];
+    if (n <= simd_block_size()) {
+        int_base_case(array, buffer, n, to_buffer);
+        return NULL;
     }
-    for (int j = 0; j < n2; j++) {
-        R[j] = array[m + 1 + j];
+
+    size_t mid = n / 2;
+    int_SortArgs leftArgs  = { array, buffer, mid, !to_buffer };
+    int_SortArgs rightArgs = { array + mid, buffer + mid, n - mid, !to_buffer };
+
+    pthread_t leftThread, rightThread;
+    int leftCreated = 0, rightCreated = 0;
+
+    if (try_acquire_token()) {
+        int ret = pthread_create(&leftThread, NULL, threaded_mergesort, &leftArgs);
+        if (ret == 0) {
+            trace_count(TRACE_THREADS_CREATED);
+            leftCreated = 1;
+        } else {
+            perror("pthread_create (left) failed");
+            release_token();
+            int_base_case(array, buffer, mid, !to_buffer);
+        }
+    } else {
+        int_base_case(array, buffer, mid, !to_buffer);
     }
 
-    int i = 0, j = 0;
-    int k = l;
-    while (i < n1 && j < n2) {
-        if (L[i] <= R[j]) {
-            array[k++] = L[i++];
+    if (try_acquire_token()) {
+        int ret = pthread_create(&rightThread, NULL, threaded_mergesort, &rightArgs);
+        if (ret == 0) {
+            trace_count(TRACE_THREADS_CREATED);
+            rightCreated = 1;
         } else {
-            array[k++] = R[j++];
+            perror("pthread_create (right) failed");
+            release_token();
+            int_base_case(array + mid, buffer + mid, n - mid, !to_buffer);
         }
+    } else {
+        int_base_case(array + mid, buffer + mid, n - mid, !to_buffer);
+    }
+
+    if (leftCreated) {
+        join_thread(leftThread);
+        release_token();
     }
-    while (i < n1) {
-        array[k++] = L[i++];
+    if (rightCreated) {
+        join_thread(rightThread);
+        release_token();
     }
-    while (j < n2) {
-        array[k++] = R[j++];
+
+    int_MergeArgs mergeArgs = int_halves(threadArgs, mid);
+    threaded_merge(&mergeArgs);
+    return NULL;
+}
+
+typedef enum { MODE_POOL, MODE_SPAWN, MODE_RADIX, MODE_NATURAL, MODE_BENCH, MODE_EXT, MODE_GEN } Mode;
+
+// Вид входных данных
+typedef enum { INPUT_RANDOM, INPUT_SORTED, INPUT_REVERSED, INPUT_BATCHES, INPUT_NEARLY } Input;
+
+static const char *mode_name(Mode mode) {
+    switch (mode) {
+    case MODE_POOL:
+        return "pool";
+    case MODE_SPAWN:
+        return "spawn";
+    case MODE_RADIX:
+        return "radix";
+    case MODE_NATURAL:
+        return "natural";
+    default:
+        return "seq";
+    }
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fill_random(int *array, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        array[i] = rand() % 1000000;
     }
+}
 
-    free(L);
-    free(R);
+// sorted - неубывающий, reversed - невозрастающий, batches - 8
+// упорядоченных пачек подряд, nearly - упорядоченный с 1% обменов
+static void fill_input(int *array, size_t n, Input input) {
+    if (input == INPUT_RANDOM) {
+        fill_random(array, n);
+        return;
+    }
+    size_t batch = input == INPUT_BATCHES ? (n + 7) / 8 : n;
+    for (size_t i = 0; i < n; i++) {
+        int value = (int)((double)(i % batch) * 1000000 / batch);
+        array[input == INPUT_REVERSED ? n - 1 - i : i] = value;
+    }
+    if (input == INPUT_NEARLY) {
+        for (size_t k = 0; k < n / 100; k++) {
+            size_t i = (size_t)rand() % n, j = (size_t)rand() % n;
+            int tmp = array[i];
+            array[i] = array[j];
+            array[j] = tmp;
+        }
+    }
 }
 
+static int is_sorted(const int *array, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        if (array[i] < array[i - 1]) {
+            return 0;
+        }
+    }
+    return 1;
+}
 
+// Сортирует и возвращает время в секундах; pool нужен всем режимам, кроме spawn
+static double timed_sort(Mode mode, Pool *pool, int max_threads, int *array, size_t n) {
+    double start = now_seconds();
+    if (mode == MODE_BENCH) {
+        seq_merge_sort(array, 0, n - 1);
+        return now_seconds() - start;
+    }
 
-void seq_merge_sort(int *array, int left, int right) {
-    if (left < right) {
-        int mid = left + (right - left) / 2;
-        seq_merge_sort(array, left, mid);
-        seq_merge_sort(array, mid + 1, right);
-        merge(array, left, mid, right);
+    // Единственное выделение памяти на всю сортировку
+    int *buffer = (int *)malloc(n * sizeof(int));
+    if (!buffer) {
+        perror("malloc for merge buffer");
+        exit(EXIT_FAILURE);
+    }
+    int_SortArgs args = { array, buffer, n, 0 };
+    if (mode == MODE_POOL) {
+        pool_run(pool, int_pool_sort, &args);
+    } else if (mode == MODE_RADIX) {
+        radix_sort(pool, array, buffer, n);
+    } else if (mode == MODE_NATURAL) {
+        // Короткие серии - обычная сортировка на тех же ядрах
+        if (!natural_sort(pool, array, buffer, n)) {
+            pool_run(pool, int_pool_sort, &args);
+        }
+    } else {
+        atomic_store(&thread_tokens, max_threads);
+        threaded_mergesort(&args);
     }
+    free(buffer);
+    return now_seconds() - start;
 }
 
+// Лучшее из нескольких повторов на одних и тех же данных
+static double best_time(Mode mode, Pool *pool, int max_threads,
+                        const int *input, int *work, size_t n, int repeats) {
+    double best = 0;
+    for (int r = 0; r < repeats; r++) {
+        memcpy(work, input, n * sizeof(int));
+        double elapsed = timed_sort(mode, pool, max_threads, work, n);
+        if (!is_sorted(work, n)) {
+            fprintf(stderr, "Error: array of %zu elements is NOT sorted\n", n);
+            exit(EXIT_FAILURE);
+        }
+        if (r == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
 
-void *threaded_mergesort(void *args) {
-    __sync_fetch_and_add(&sort_calls, 1);
+// Размеры 10^5, 10^6, ... до array_size, потоки 1, 2, 4, ... до max_threads.
+// Ускорение и эффективность - относительно скалярной seq_merge_sort;
+// строка с именем ядер - та же сортировка в одном потоке на векторных
+// ядрах, параллельные режимы идут на выбранных ядрах, radix и natural - на пуле
+static void run_benchmark(int max_threads, size_t array_size, SimdLevel level, Input shape) {
+    const int repeats = 3;
+    int *input = (int *)malloc(array_size * sizeof(int));
+    int *work = (int *)malloc(array_size * sizeof(int));
+    if (!input || !work) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    fill_input(input, array_size, shape);
+
+    printf("%12s %8s %7s %12s %9s %11s\n",
+           "size", "threads", "mode", "seconds", "speedup", "efficiency");
+    for (size_t size = 100000; ; size *= 10) {
+        size_t n = size < array_size ? size : array_size;
+        simd_select(SIMD_SCALAR);
+        double seq = best_time(MODE_BENCH, NULL, 1, input, work, n, repeats);
+        printf("%12zu %8d %7s %12.6f %9.2f %10.0f%%\n", n, 1, "seq", seq, 1.0, 100.0);
+
+        simd_select(level);
+        if (level != SIMD_SCALAR) {
+            double vec = best_time(MODE_BENCH, NULL, 1, input, work, n, repeats);
+            printf("%12zu %8d %7s %12.6f %9.2f %10.0f%%\n", n, 1, simd_name(level),
+                   vec, seq / vec, 100.0 * seq / vec);
+        }
 
-    ThreadArgs *threadArgs = (ThreadArgs *)args;
-    int *array = threadArgs->array;
-    int left = threadArgs->left;
-    int right = threadArgs->right;
-
-    if (left < right) {
-        int mid = left + (right - left) / 2;
-
-        ThreadArgs leftArgs  = { array, left, mid };
-        ThreadArgs rightArgs = { array, mid + 1, right };
-
-        pthread_t leftThread, rightThread;
-        int leftCreated = 0, rightCreated = 0;
-
-        long left_wait_res = dispatch_semaphore_wait(gcd_sem, DISPATCH_TIME_NOW);
-        if (left_wait_res == 0) {
-            int ret = pthread_create(&leftThread, NULL, threaded_mergesort, &leftArgs);
-            if (ret == 0) {
-                __sync_fetch_and_add(&threads_created, 1);
-                leftCreated = 1;
-            } else {
-                perror("pthread_create (left) failed");
-                dispatch_semaphore_signal(gcd_sem);
-                seq_merge_sort(array, left, mid);
+        for (int threads = 1; ; threads = threads * 2 < max_threads ? threads * 2 : max_threads) {
+            Pool *pool = pool_create(threads);
+            if (!pool) {
+                perror("pool_create");
+                exit(EXIT_FAILURE);
             }
-        } else {
-            seq_merge_sort(array, left, mid);
-        }
-
-        long right_wait_res = dispatch_semaphore_wait(gcd_sem, DISPATCH_TIME_NOW);
-        if (right_wait_res == 0) {
-            int ret = pthread_create(&rightThread, NULL, threaded_mergesort, &rightArgs);
-            if (ret == 0) {
-                __sync_fetch_and_add(&threads_created, 1);
-                rightCreated = 1;
-            } else {
-                perror("pthread_create (right) failed");
-                dispatch_semaphore_signal(gcd_sem);
-                seq_merge_sort(array, mid + 1, right);
+            for (Mode mode = MODE_POOL; mode <= MODE_NATURAL; mode++) {
+                double elapsed = best_time(mode, pool, threads, input, work, n, repeats);
+                double speedup = seq / elapsed;
+                printf("%12zu %8d %7s %12.6f %9.2f %10.0f%%\n", n, threads,
+                       mode_name(mode), elapsed, speedup, 100.0 * speedup / threads);
             }
-        } else {
-            seq_merge_sort(array, mid + 1, right);
+            pool_destroy(pool);
+            if (threads == max_threads) {
+                break;
+            }
+        }
+        if (n == array_size) {
+            break;
         }
+    }
+
+    free(input);
+    free(work);
+}
+
+// Кусок внешней сортировки сортируется пулом, буфер даёт extsort
+static void sort_chunk_in_pool(int *array, int *buffer, size_t n, void *arg) {
+    int_SortArgs args = { array, buffer, n, 0 };
+    pool_run((Pool *)arg, int_pool_sort, &args);
+}
+
+#define FILE_BLOCK (1 << 20)    // int за одно чтение/запись файла
 
-        if (leftCreated) {
-            pthread_join(leftThread, NULL);
-            dispatch_semaphore_signal(gcd_sem);
+static int write_random_file(const char *path, size_t n) {
+    FILE *file = fopen(path, "wb");
+    int *block = (int *)malloc(FILE_BLOCK * sizeof(int));
+    if (!file || !block) {
+        perror(path);
+        free(block);
+        if (file) {
+            fclose(file);
         }
-        if (rightCreated) {
-            pthread_join(rightThread, NULL);
-            dispatch_semaphore_signal(gcd_sem);
+        return -1;
+    }
+    int ok = 1;
+    for (size_t done = 0; done < n && ok; done += FILE_BLOCK) {
+        size_t len = n - done < FILE_BLOCK ? n - done : FILE_BLOCK;
+        fill_random(block, len);
+        ok = fwrite(block, sizeof(int), len, file) == len;
+    }
+    free(block);
+    if (fclose(file) != 0 || !ok) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+// 1 - отсортирован, 0 - нет, -1 - ошибка чтения
+static int file_is_sorted(const char *path) {
+    FILE *file = fopen(path, "rb");
+    int *block = (int *)malloc(FILE_BLOCK * sizeof(int));
+    if (!file || !block) {
+        perror(path);
+        free(block);
+        if (file) {
+            fclose(file);
         }
+        return -1;
+    }
+    int sorted = 1, have_prev = 0, prev = 0;
+    size_t len;
+    while (sorted && (len = fread(block, sizeof(int), FILE_BLOCK, file)) > 0) {
+        if ((have_prev && block[0] < prev) || !is_sorted(block, len)) {
+            sorted = 0;
+        }
+        prev = block[len - 1];
+        have_prev = 1;
+    }
+    if (ferror(file)) {
+        perror(path);
+        sorted = -1;
+    }
+    free(block);
+    fclose(file);
+    return sorted;
+}
 
-        merge(array, left, mid, right);
+static int write_trace(const char *path, void (*writer)(FILE *out)) {
+    if (!path) {
+        return 0;
+    }
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        return -1;
+    }
+    writer(out);
+    if (fclose(out) != 0) {
+        perror(path);
+        return -1;
     }
+    return 0;
+}
 
-    return NULL;
+// Сводка пишется после pool_destroy: простой потоков в хвосте
+// сортировки закрывается только их остановкой
+static int write_traces(const char *stats_path, const char *trace_path) {
+    int stats = write_trace(stats_path, trace_write_json);
+    int trace = write_trace(trace_path, trace_write_chrome);
+    return stats == 0 && trace == 0 ? 0 : -1;
 }
 
 int main(int argc, char *argv[]) {
+    // --stats FILE - счётчики и время по потокам в JSON, --trace FILE -
+    // ещё и интервалы в формате Chrome trace; можно указать где угодно
+    const char *stats_path = NULL, *trace_path = NULL;
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            stats_path = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+    argv[argc] = NULL;
+    TraceLevel trace_level = trace_path ? TRACE_EVENTS : stats_path ? TRACE_TIMERS : TRACE_OFF;
+
     if (argc < 3) {
-        fprintf(stderr, "Usage: %s <max_threads> <array_size>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <max_threads> <array_size> [pool|spawn|radix|natural|bench] [kernels] [input]\n"
+                        "       %s <max_threads> <chunk_size> ext <input> <output> [kernels]\n"
+                        "       %s <max_threads> <count> gen <output>\n"
+                        "kernels: scalar, avx2 or avx512\n"
+                        "input: random, sorted, reversed, batches or nearly\n"
+                        "--stats FILE, --trace FILE: per-thread JSON summary, Chrome trace\n",
+                argv[0], argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // pool - постоянный пул с перехватом работы,
+    // spawn - прежний поток на каждое деление, пока есть разрешения,
+    // radix - поразрядная сортировка на том же пуле,
+    // natural - слияние готовых серий входа, если они есть,
+    // bench - перебор размеров и числа потоков,
+    // ext - внешняя сортировка файла кусками по array_size элементов,
+    // gen - файл из array_size случайных чисел для ext
+    Mode mode = MODE_POOL;
+    int kernels_arg = 4;
+    if (argc > 3) {
+        if (strcmp(argv[3], "spawn") == 0) {
+            mode = MODE_SPAWN;
+        } else if (strcmp(argv[3], "radix") == 0) {
+            mode = MODE_RADIX;
+        } else if (strcmp(argv[3], "natural") == 0) {
+            mode = MODE_NATURAL;
+        } else if (strcmp(argv[3], "bench") == 0) {
+            mode = MODE_BENCH;
+        } else if (strcmp(argv[3], "ext") == 0) {
+            mode = MODE_EXT;
+            kernels_arg = 6;
+        } else if (strcmp(argv[3], "gen") == 0) {
+            mode = MODE_GEN;
+            kernels_arg = 5;
+        } else if (strcmp(argv[3], "pool") != 0) {
+            fprintf(stderr, "Error: unknown mode '%s', expected pool, spawn, radix, natural, bench, ext or gen.\n", argv[3]);
+            return EXIT_FAILURE;
+        }
+    }
+    if ((mode == MODE_EXT || mode == MODE_GEN) && argc < kernels_arg) {
+        fprintf(stderr, "Error: mode '%s' needs %s.\n", argv[3],
+                mode == MODE_EXT ? "input and output files" : "an output file");
         return EXIT_FAILURE;
     }
 
+    // По умолчанию - лучшие ядра, которые есть у процессора
+    SimdLevel level = simd_detect();
+    if (argc > kernels_arg) {
+        if (strcmp(argv[kernels_arg], "scalar") == 0) {
+            level = SIMD_SCALAR;
+        } else if (strcmp(argv[kernels_arg], "avx2") == 0) {
+            level = SIMD_AVX2;
+        } else if (strcmp(argv[kernels_arg], "avx512") == 0) {
+            level = SIMD_AVX512;
+        } else {
+            fprintf(stderr, "Error: unknown kernels '%s', expected scalar, avx2 or avx512.\n",
+                    argv[kernels_arg]);
+            return EXIT_FAILURE;
+        }
+    }
+    simd_select(level);
+    level = simd_level();
+
+    Input shape = INPUT_RANDOM;
+    if (argc > kernels_arg + 1) {
+        const char *names[] = { "random", "sorted", "reversed", "batches", "nearly" };
+        int found = -1;
+        for (int i = 0; i < 5; i++) {
+            if (strcmp(argv[kernels_arg + 1], names[i]) == 0) {
+                found = i;
+            }
+        }
+        if (found < 0) {
+            fprintf(stderr, "Error: unknown input '%s', expected random, sorted, reversed, batches or nearly.\n",
+                    argv[kernels_arg + 1]);
+            return EXIT_FAILURE;
+        }
+        shape = (Input)found;
+    }
+
+    // Размер - 64-битный: файлы и массивы больше 2^31 элементов
     int max_threads = atoi(argv[1]);
-    int array_size = atoi(argv[2]);
-    if (max_threads <= 0 || array_size <= 0) {
+    char *end;
+    unsigned long long parsed = strtoull(argv[2], &end, 10);
+    size_t array_size = (size_t)parsed;
+    if (max_threads <= 0 || parsed == 0 || *end != '\0' || argv[2][0] == '-') {
         fprintf(stderr, "Error: max_threads and array_size must be positive integers.\n");
         return EXIT_FAILURE;
     }
 
+    srand((unsigned)time(NULL));
+    if (mode == MODE_BENCH) {
+        run_benchmark(max_threads, array_size, level, shape);
+        trace_free();
+        return EXIT_SUCCESS;
+    }
+    if (mode == MODE_GEN) {
+        return write_random_file(argv[4], array_size) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (mode == MODE_EXT) {
+        Pool *pool = pool_create(max_threads);
+        if (!pool) {
+            perror("pool_create");
+            return EXIT_FAILURE;
+        }
+        trace_enable(trace_level);
+        double start = now_seconds();
+        int result = external_sort(argv[4], argv[5], array_size, sort_chunk_in_pool, pool);
+        double elapsed = now_seconds() - start;
+        pool_destroy(pool);
+        int traced = result == 0 ? write_traces(stats_path, trace_path) : 0;
+        trace_free();
+        if (result != 0 || traced != 0) {
+            return EXIT_FAILURE;
+        }
+        int sorted = file_is_sorted(argv[5]);
+        printf("File is %s\n", sorted == 1 ? "sorted" : "NOT sorted");
+        printf("Time taken: %.6f seconds\n", elapsed);
+        return sorted == 1 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     int *array = (int *)malloc(array_size * sizeof(int));
     if (!array) {
         perror("malloc");
         return EXIT_FAILURE;
     }
-
-    srand((unsigned)time(NULL));
-    for (int i = 0; i < array_size; i++) {
-        array[i] = rand() % 1000000; 
+    fill_input(array, array_size, shape);
+
+    // Пул создаётся до замера: потоки живут дольше одной сортировки
+    Pool *pool = NULL;
+    if (mode == MODE_POOL || mode == MODE_RADIX || mode == MODE_NATURAL) {
+        pool = pool_create(max_threads);
+        if (!pool) {
+            perror("pool_create");
+            return EXIT_FAILURE;
+        }
     }
 
-    gcd_sem = dispatch_semaphore_create(max_threads);
-
-    struct timeval start, end;
-    gettimeofday(&start, NULL);
-
-    ThreadArgs args = { array, 0, array_size - 1 };
-    threaded_mergesort(&args);
-
-    gettimeofday(&end, NULL);
-
-    double elapsed = (end.tv_sec - start.tv_sec) +
-                     (end.tv_usec - start.tv_usec) / 1000000.0;
-
-
-    int sorted = 1;
-    for (int i = 1; i < array_size; i++) {
-        if (array[i] < array[i - 1]) {
-            sorted = 0;
-            break;
-        }
+    trace_enable(trace_level);
+    double elapsed = timed_sort(mode, pool, max_threads, array, array_size);
+    if (pool) {
+        pool_destroy(pool);
     }
 
-    printf("Array is %s\n", (sorted ? "sorted" : "NOT sorted"));
+    printf("Array is %s\n", (is_sorted(array, array_size) ? "sorted" : "NOT sorted"));
     printf("Time taken: %.6f seconds\n", elapsed);
-    // printf("Number of mergesort (threaded) calls: %d\n", sort_calls);
-    // printf("Number of merges: %d\n", merge_calls);
-    // printf("Threads created: %d\n", threads_created);
+    int traced = write_traces(stats_path, trace_path);
+    trace_free();
 
     free(array);
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+    return traced == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
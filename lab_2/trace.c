@@ -0,0 +1,273 @@
+#include "trace.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CACHE_LINE 64
+#define MAX_EVENTS 16384    // На поток; сверх этого интервалы идут только в сумму
+
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    TraceKind kind;
+} TraceEvent;
+
+// Поля пишет только поток-владелец; атомарные они ради чтения сводки
+// из другого потока, обновление - relaxed load + store, без lock-префикса
+typedef struct ThreadTrace {
+    _Alignas(CACHE_LINE) atomic_uint_fast64_t counts[TRACE_COUNTERS];
+    atomic_uint_fast64_t ns[TRACE_KINDS];
+    atomic_size_t num_events;
+    TraceEvent *events;
+    int id;
+    struct ThreadTrace *next;
+    struct ThreadTrace *next_spare;
+} ThreadTrace;
+
+static const char *kind_names[TRACE_KINDS] = { "merge", "base", "join", "idle" };
+static const char *counter_names[TRACE_COUNTERS] = { "merge_calls", "sort_calls", "threads_created" };
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static ThreadTrace *registry = NULL;    // Записи всех потоков, в том числе завершённых
+static ThreadTrace *spare = NULL;       // Записи завершённых потоков для новых
+static int registered = 0;
+static pthread_key_t exit_key;          // Деструктор отдаёт запись в spare
+static pthread_once_t exit_key_once = PTHREAD_ONCE_INIT;
+static atomic_int trace_level = TRACE_OFF;
+static uint64_t epoch;                  // Ноль времени trace-файла
+
+static __thread ThreadTrace *self = NULL;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// Запись остаётся в registry со всеми счётами, а писать в неё дальше
+// будет следующий новый поток
+static void release_self(void *arg) {
+    ThreadTrace *t = arg;
+    pthread_mutex_lock(&registry_lock);
+    t->next_spare = spare;
+    spare = t;
+    pthread_mutex_unlock(&registry_lock);
+    self = NULL;
+}
+
+static void create_exit_key(void) {
+    if (pthread_key_create(&exit_key, release_self) != 0) {
+        perror("pthread_key_create for trace");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static ThreadTrace *get_self(void) {
+    if (self) {
+        return self;
+    }
+    pthread_once(&exit_key_once, create_exit_key);
+    pthread_mutex_lock(&registry_lock);
+    ThreadTrace *t = spare;
+    if (t) {
+        spare = t->next_spare;
+    } else {
+        t = aligned_alloc(CACHE_LINE, sizeof(ThreadTrace));
+        if (!t) {
+            perror("aligned_alloc for trace");
+            exit(EXIT_FAILURE);
+        }
+        memset(t, 0, sizeof(ThreadTrace));
+        t->id = registered++;
+        t->next = registry;
+        registry = t;
+    }
+    pthread_mutex_unlock(&registry_lock);
+    pthread_setspecific(exit_key, t);
+    self = t;
+    return t;
+}
+
+static inline void bump(atomic_uint_fast64_t *value, uint64_t delta) {
+    atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + delta,
+                          memory_order_relaxed);
+}
+
+void trace_enable(TraceLevel level) {
+    pthread_mutex_lock(&registry_lock);
+    for (ThreadTrace *t = registry; t; t = t->next) {
+        for (int c = 0; c < TRACE_COUNTERS; c++) {
+            atomic_store(&t->counts[c], 0);
+        }
+        for (int k = 0; k < TRACE_KINDS; k++) {
+            atomic_store(&t->ns[k], 0);
+        }
+        atomic_store(&t->num_events, 0);
+    }
+    pthread_mutex_unlock(&registry_lock);
+    epoch = now_ns();
+    atomic_store(&trace_level, level);
+}
+
+void trace_free(void) {
+    pthread_mutex_lock(&registry_lock);
+    while (registry) {
+        ThreadTrace *next = registry->next;
+        free(registry->events);
+        free(registry);
+        registry = next;
+    }
+    spare = NULL;
+    registered = 0;
+    pthread_mutex_unlock(&registry_lock);
+    if (self) {
+        pthread_setspecific(exit_key, NULL);
+        self = NULL;
+    }
+}
+
+void trace_count(TraceCounter counter) {
+    bump(&get_self()->counts[counter], 1);
+}
+
+uint64_t trace_begin(void) {
+    if (atomic_load_explicit(&trace_level, memory_order_relaxed) == TRACE_OFF) {
+        return 0;
+    }
+    return now_ns();
+}
+
+void trace_end(TraceKind kind, uint64_t start) {
+    if (start == 0) {
+        return;
+    }
+    uint64_t end = now_ns();
+    ThreadTrace *t = get_self();
+    bump(&t->ns[kind], end - start);
+
+    if (atomic_load_explicit(&trace_level, memory_order_relaxed) != TRACE_EVENTS) {
+        return;
+    }
+    size_t n = atomic_load_explicit(&t->num_events, memory_order_relaxed);
+    if (n == MAX_EVENTS) {
+        return;
+    }
+    if (!t->events) {
+        t->events = malloc(MAX_EVENTS * sizeof(TraceEvent));
+        if (!t->events) {
+            return;
+        }
+    }
+    t->events[n] = (TraceEvent){ start, end, kind };
+    atomic_store_explicit(&t->num_events, n + 1, memory_order_release);
+}
+
+// Записи в порядке номеров потоков; вызывающий освобождает массив
+static ThreadTrace **sorted_threads(int *count) {
+    pthread_mutex_lock(&registry_lock);
+    *count = registered;
+    ThreadTrace **threads = calloc(registered ? registered : 1, sizeof(ThreadTrace *));
+    if (threads) {
+        for (ThreadTrace *t = registry; t; t = t->next) {
+            threads[t->id] = t;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return threads;
+}
+
+static int is_empty(ThreadTrace *t) {
+    for (int c = 0; c < TRACE_COUNTERS; c++) {
+        if (atomic_load(&t->counts[c])) {
+            return 0;
+        }
+    }
+    for (int k = 0; k < TRACE_KINDS; k++) {
+        if (atomic_load(&t->ns[k])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void write_values(FILE *out, const uint64_t *counts, const uint64_t *ns) {
+    for (int c = 0; c < TRACE_COUNTERS; c++) {
+        fprintf(out, "\"%s\": %llu, ", counter_names[c], (unsigned long long)counts[c]);
+    }
+    for (int k = 0; k < TRACE_KINDS; k++) {
+        fprintf(out, "\"%s_ms\": %.3f%s", kind_names[k], ns[k] / 1e6,
+                k + 1 < TRACE_KINDS ? ", " : "");
+    }
+}
+
+// Потоки без единого счёта (например, завершённые до trace_enable) пропускаются
+void trace_write_json(FILE *out) {
+    int count;
+    ThreadTrace **threads = sorted_threads(&count);
+    if (!threads) {
+        return;
+    }
+    uint64_t total_counts[TRACE_COUNTERS] = { 0 };
+    uint64_t total_ns[TRACE_KINDS] = { 0 };
+    int first = 1;
+
+    fprintf(out, "{\n  \"threads\": [\n");
+    for (int i = 0; i < count; i++) {
+        ThreadTrace *t = threads[i];
+        if (is_empty(t)) {
+            continue;
+        }
+        uint64_t counts[TRACE_COUNTERS], ns[TRACE_KINDS];
+        for (int c = 0; c < TRACE_COUNTERS; c++) {
+            counts[c] = atomic_load(&t->counts[c]);
+            total_counts[c] += counts[c];
+        }
+        for (int k = 0; k < TRACE_KINDS; k++) {
+            ns[k] = atomic_load(&t->ns[k]);
+            total_ns[k] += ns[k];
+        }
+        fprintf(out, "%s    {\"id\": %d, ", first ? "" : ",\n", t->id);
+        write_values(out, counts, ns);
+        fprintf(out, "}");
+        first = 0;
+    }
+    fprintf(out, "\n  ],\n  \"total\": {");
+    write_values(out, total_counts, total_ns);
+    fprintf(out, "}\n}\n");
+    free(threads);
+}
+
+void trace_write_chrome(FILE *out) {
+    int count;
+    ThreadTrace **threads = sorted_threads(&count);
+    if (!threads) {
+        return;
+    }
+    int first = 1;
+
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for (int i = 0; i < count; i++) {
+        ThreadTrace *t = threads[i];
+        size_t n = atomic_load_explicit(&t->num_events, memory_order_acquire);
+        if (n == 0) {
+            continue;
+        }
+        fprintf(out, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, "
+                     "\"args\": {\"name\": \"thread %d\"}}", first ? "" : ",\n", t->id, t->id);
+        first = 0;
+        for (size_t e = 0; e < n; e++) {
+            const TraceEvent *event = &t->events[e];
+            if (event->start < epoch) {
+                continue;
+            }
+            fprintf(out, ",\n{\"name\": \"%s\", \"cat\": \"sort\", \"ph\": \"X\", \"pid\": 1, "
+                         "\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                    kind_names[event->kind], t->id, (event->start - epoch) / 1e3,
+                    (event->end - event->start) / 1e3);
+        }
+    }
+    fprintf(out, "\n]}\n");
+    free(threads);
+}
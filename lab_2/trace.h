@@ -0,0 +1,56 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Счётчики и таймеры сортировки по потокам. Каждый поток пишет только в
+// свою запись (заводится при первом обращении), поэтому обновление -
+// обычная запись в свою строку кэша без атомарных RMW и без общих
+// переменных. Сводка собирается по всем записям в конце. Запись
+// завершившегося потока продолжает следующий новый поток, так что
+// записей столько, сколько потоков работало одновременно.
+// Таймеры и события включаются trace_enable; выключенные стоят одной
+// проверки флага.
+
+typedef enum {
+    TRACE_MERGE,        // Параллельный шаг слияния
+    TRACE_BASE,         // Последовательная сортировка участка
+    TRACE_JOIN,         // Ожидание дочерней задачи или потока
+    TRACE_IDLE,         // Поток пула без работы
+    TRACE_KINDS
+} TraceKind;
+
+typedef enum {
+    TRACE_MERGE_CALLS,
+    TRACE_SORT_CALLS,
+    TRACE_THREADS_CREATED,
+    TRACE_COUNTERS
+} TraceCounter;
+
+typedef enum {
+    TRACE_OFF,          // Только счётчики
+    TRACE_TIMERS,       // Счётчики и время по видам
+    TRACE_EVENTS        // Плюс каждый интервал для trace-файла
+} TraceLevel;
+
+// Обнуляет накопленное и задаёт уровень; вызывать, пока сортировка не идёт
+void trace_enable(TraceLevel level);
+
+// Освобождает все записи; вызывать в конце, когда другие потоки,
+// писавшие в трассу, уже завершены
+void trace_free(void);
+
+void trace_count(TraceCounter counter);
+
+// Начало интервала: 0, если таймеры выключены
+uint64_t trace_begin(void);
+// Конец интервала, начатого trace_begin в том же потоке
+void trace_end(TraceKind kind, uint64_t start);
+
+// Сводка по потокам и итог в JSON
+void trace_write_json(FILE *out);
+// Интервалы в формате Chrome trace events (chrome://tracing, Perfetto)
+void trace_write_chrome(FILE *out);
+
+#endif